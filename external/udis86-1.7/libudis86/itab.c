@@ -902,6 +902,10 @@ const char * ud_mnemonics_str[] = {
   "xor",
   "xorpd",
   "xorps",
+  "xrstor",
+  "xsave",
+  "xsavec",
+  "xsaveopt",
 };
 
 
@@ -1397,14 +1401,14 @@ static struct ud_itab_entry itab__0f__op_ae__reg[8] = {
   /* 01 */  { UD_Ifxrstor,     O_M,     O_NONE,  O_NONE,  O_NONE, F_none, F_none, R_none, R_STA | R_MMA, P_aso|P_rexw|P_rexr|P_rexx|P_rexb },
   /* 02 */  { UD_Ildmxcsr,     O_Md,    O_NONE,  O_NONE,  O_NONE, F_none, F_none, R_none, R_none, P_aso|P_rexw|P_rexr|P_rexx|P_rexb },
   /* 03 */  { UD_Istmxcsr,     O_Md,    O_NONE,  O_NONE,  O_NONE, F_none, F_none, R_none, R_none, P_aso|P_rexw|P_rexr|P_rexx|P_rexb },
-  /* 04 */  { UD_Iinvalid,     O_NONE, O_NONE, O_NONE, O_NONE, F_none, F_none, R_none, R_none, P_none },
+  /* 04 */  { UD_Ixsave,       O_M,     O_NONE,  O_NONE,  O_NONE, F_none, F_none, R_AX | R_DX | R_STA | R_MMA, R_none, P_aso|P_rexw|P_rexr|P_rexx|P_rexb },
   /* 05 */  { UD_Igrp_mod,     O_NONE, O_NONE, O_NONE, O_NONE, F_none, F_none, R_none, R_none, ITAB__0F__OP_AE__REG__OP_05__MOD },
   /* 06 */  { UD_Igrp_mod,     O_NONE, O_NONE, O_NONE, O_NONE, F_none, F_none, R_none, R_none, ITAB__0F__OP_AE__REG__OP_06__MOD },
   /* 07 */  { UD_Igrp_mod,     O_NONE, O_NONE, O_NONE, O_NONE, F_none, F_none, R_none, R_none, ITAB__0F__OP_AE__REG__OP_07__MOD },
 };
 
 static struct ud_itab_entry itab__0f__op_ae__reg__op_05__mod[2] = {
-  /* 00 */  { UD_Iinvalid,     O_NONE, O_NONE, O_NONE, O_NONE, F_none, F_none, R_none, R_none, P_none },
+  /* 00 */  { UD_Ixrstor,      O_M,     O_NONE,  O_NONE,  O_NONE, F_none, F_none, R_AX | R_DX, R_STA | R_MMA, P_aso|P_rexw|P_rexr|P_rexx|P_rexb },
   /* 01 */  { UD_Igrp_rm,      O_NONE, O_NONE, O_NONE, O_NONE, F_none, F_none, R_none, R_none, ITAB__0F__OP_AE__REG__OP_05__MOD__OP_01__RM },
 };
 
@@ -1420,7 +1424,7 @@ static struct ud_itab_entry itab__0f__op_ae__reg__op_05__mod__op_01__rm[8] = {
 };
 
 static struct ud_itab_entry itab__0f__op_ae__reg__op_06__mod[2] = {
-  /* 00 */  { UD_Iinvalid,     O_NONE, O_NONE, O_NONE, O_NONE, F_none, F_none, R_none, R_none, P_none },
+  /* 00 */  { UD_Ixsaveopt,    O_M,     O_NONE,  O_NONE,  O_NONE, F_none, F_none, R_AX | R_DX | R_STA | R_MMA, R_none, P_aso|P_rexw|P_rexr|P_rexx|P_rexb },
   /* 01 */  { UD_Igrp_rm,      O_NONE, O_NONE, O_NONE, O_NONE, F_none, F_none, R_none, R_none, ITAB__0F__OP_AE__REG__OP_06__MOD__OP_01__RM },
 };
 
@@ -1467,7 +1471,7 @@ static struct ud_itab_entry itab__0f__op_c7__reg[8] = {
   /* 01 */  { UD_Icmpxchg8b,   O_M,     O_NONE,  O_NONE,  O_NONE, F_none, F_ZF, R_AX | R_BX | R_CX | R_DX, R_AX | R_DX, P_aso|P_rexr|P_rexx|P_rexb },
   /* 02 */  { UD_Iinvalid,     O_NONE, O_NONE, O_NONE, O_NONE, F_none, F_none, R_none, R_none, P_none },
   /* 03 */  { UD_Iinvalid,     O_NONE, O_NONE, O_NONE, O_NONE, F_none, F_none, R_none, R_none, P_none },
-  /* 04 */  { UD_Iinvalid,     O_NONE, O_NONE, O_NONE, O_NONE, F_none, F_none, R_none, R_none, P_none },
+  /* 04 */  { UD_Ixsavec,      O_M,     O_NONE,  O_NONE,  O_NONE, F_none, F_none, R_AX | R_DX | R_STA | R_MMA, R_none, P_aso|P_rexw|P_rexr|P_rexx|P_rexb },
   /* 05 */  { UD_Iinvalid,     O_NONE, O_NONE, O_NONE, O_NONE, F_none, F_none, R_none, R_none, P_none },
   /* 06 */  { UD_Iinvalid,     O_NONE, O_NONE, O_NONE, O_NONE, F_none, F_none, R_none, R_none, P_none },
   /* 07 */  { UD_Igrp_vendor,  O_NONE, O_NONE, O_NONE, O_NONE, F_none, F_none, R_none, R_none, ITAB__0F__OP_C7__REG__OP_07__VENDOR },
@@ -1068,6 +1068,10 @@ enum ud_mnemonic_code {
   UD_Ixor,
   UD_Ixorpd,
   UD_Ixorps,
+  UD_Ixrstor,
+  UD_Ixsave,
+  UD_Ixsavec,
+  UD_Ixsaveopt,
   UD_Itotaltypes,
   UD_Id3vil,
   UD_Ina,
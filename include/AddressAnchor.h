@@ -22,6 +22,9 @@
 #define _AddressAnchor_h_
 
 #include <Base.h>
+#include <map>
+
+class AddressAnchorIndex;
 
 extern int searchLinkBaseAddressExact(const void* arg1, const void* arg2);
 extern int searchLinkBaseAddress(const void* arg1, const void* arg2);
@@ -43,6 +46,11 @@ private:
     uint32_t index;
     LinkClasses linkClass;
 
+    // where this anchor sits in the index, which lags linkBaseAddress until the index is updated
+    AddressAnchorIndex* anchorIndex;
+    uint64_t indexedAddress;
+    uint32_t indexedOrder;
+
     void dump8(BinaryOutputFile* b, uint32_t offset, uint8_t value);
     void dump16(BinaryOutputFile* b, uint32_t offset, uint16_t value);
     void dump32(BinaryOutputFile* b, uint32_t offset, uint32_t value);
@@ -75,6 +83,32 @@ public:
     bool verify();
     void print();
     void dump(BinaryOutputFile* b, uint32_t offset);
+
+    friend class AddressAnchorIndex;
+};
+
+// anchors of a file sorted by the address they link to. anchors appended to the file are picked up
+// and anchors whose link moved are re-keyed together at the start of the next search, so a lookup
+// costs O(log n) plus the moved anchors rather than a scan or sort of every anchor. not thread safe
+class AddressAnchorIndex {
+private:
+    typedef std::pair<uint64_t, uint32_t> AnchorKey;
+
+    Vector<AddressAnchor*>* anchors;
+    uint32_t numberIndexed;
+    std::map<AnchorKey, AddressAnchor*> sorted;
+    Vector<AddressAnchor*> moved;
+
+    void insert(AddressAnchor* a, uint32_t order);
+    void rebuild();
+    void update();
+
+public:
+    AddressAnchorIndex(Vector<AddressAnchor*>* all);
+    ~AddressAnchorIndex();
+
+    void markMoved(AddressAnchor* a) { moved.append(a); }
+    Vector<AddressAnchor*>* search(uint64_t addr);
 };
 
 #endif // _AddressAnchor_h_
@@ -0,0 +1,91 @@
+/*
+ * This file is part of the pebil project.
+ *
+ * Copyright (c) 2010, University of California Regents
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _AnalysisCache_h_
+#define _AnalysisCache_h_
+
+#include <Base.h>
+#include <map>
+
+class ElfFile;
+class Function;
+
+#define ANALYSIS_CACHE_MAGIC "PEBILAC"
+#define ANALYSIS_CACHE_FORMAT 1
+#define ANALYSIS_CACHE_VERSION_SIZE 64
+#define ANALYSIS_CACHE_SHA1_SIZE 48
+
+struct AnalysisCacheHeader {
+    char magic[8];
+    uint32_t format;
+    uint32_t registerWords;
+    char version[ANALYSIS_CACHE_VERSION_SIZE];
+    char sha1[ANALYSIS_CACHE_SHA1_SIZE];
+    uint32_t numberOfFunctions;
+    uint32_t reserved;
+};
+
+// one record per function. it is followed by the offset of every instruction from the function
+// base (recursive disassembly only) and then by a live-in and live-out register set per instruction
+struct FunctionAnalysis {
+    uint64_t baseAddress;
+    uint64_t badInstruction;
+    uint32_t sizeInBytes;
+    uint32_t recursive;
+    uint32_t numberOfInstructions;
+    uint32_t numberOfLiveSets;
+};
+
+// saves the disassembly outcome, instruction boundaries and liveness of every function in a
+// binary to <dir>/<sha1>-<version>-<build>.cache. on a later run of the same binary and the same pebil build the
+// file is mapped and functions decode straight from the saved boundaries and take their liveness
+// from it rather than recomputing it
+class AnalysisCache {
+private:
+    static char* directory;
+    static char* version;
+
+    ElfFile* elfFile;
+    char* fileName;
+
+    void* mapped;
+    uint64_t mappedSize;
+    std::map<uint64_t, FunctionAnalysis*> functions;
+
+    bool validate(AnalysisCacheHeader* header);
+
+public:
+    static void setDirectory(char* dir, char* ver);
+    static bool isEnabled() { return (directory != NULL); }
+
+    static uint32_t* getInstructionOffsets(FunctionAnalysis* fa) { return (uint32_t*)(fa + 1); }
+    static uint32_t* getLiveSets(FunctionAnalysis* fa) { return getInstructionOffsets(fa) + fa->numberOfInstructions; }
+    static uint64_t recordSize(uint64_t numberOfInstructions, uint64_t numberOfLiveSets);
+
+    AnalysisCache(ElfFile* elf);
+    ~AnalysisCache();
+
+    bool load();
+    bool isLoaded() { return (mapped != NULL); }
+    FunctionAnalysis* getFunctionAnalysis(Function* f);
+    void store();
+};
+
+#endif /* _AnalysisCache_h_ */
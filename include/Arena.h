@@ -0,0 +1,90 @@
+/*
+ * This file is part of the pebil project.
+ *
+ * Copyright (c) 2010, University of California Regents
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _Arena_h_
+#define _Arena_h_
+
+#include <Base.h>
+#include <pthread.h>
+
+#define ARENA_CHUNK_SIZE (1 << 20)
+#define ARENA_REGION_SIZE (1 << 16)
+#define ARENA_ALIGNMENT 8
+#define ARENA_MAX_OBJECT 1024
+#define ARENA_BINS (ARENA_MAX_OBJECT / ARENA_ALIGNMENT + 1)
+
+// carves small objects out of large chunks so they carry no per-allocation header and are all
+// returned at once when the arena goes away. a freed object goes on a free list for its size and is
+// handed out again, so an arena only grows to the peak number of live objects. objects are taken
+// from the current arena, which an ElfFile sets for its lifetime, or from a process-wide arena if
+// there is none.
+//
+// chunks are aligned to their size and start with the arena that owns them, so an object is always
+// freed to the arena it came from. each thread bumps through its own region of a chunk and keeps its
+// own free lists, so the lock is only taken to hand out a region or to free another thread's objects.
+// a thread gives back what it holds with releaseThreadCache when it is done with the arena
+class Arena {
+private:
+    pthread_mutex_t lock;
+
+    Vector<char*> chunks;
+    char* next;
+    char* limit;
+    char* spareRegions;
+    void* freeLists[ARENA_BINS];
+
+    uint64_t bytesUsed;
+    uint64_t objectsMade;
+    uint64_t objectsFreed;
+    uint64_t objectsReused;
+
+    static Arena* current;
+
+    void* allocate(uint32_t size);
+    void release(void* p, uint32_t size);
+    void refill(uint32_t size, uint32_t bin);
+
+public:
+    Arena();
+    ~Arena();
+
+    static Arena* getCurrent() { return current; }
+    static void setCurrent(Arena* a) { current = a; }
+
+    static void* allocateObject(size_t size);
+    static void releaseObject(void* p, size_t size);
+    static void releaseThreadCache();
+
+    uint64_t getSizeInBytes() { return (uint64_t)chunks.size() * ARENA_CHUNK_SIZE; }
+    void print();
+};
+
+// gives a class the arena's operator new/delete. the memory tracker replaces new with a macro that
+// cannot be used to declare an operator, so tracked builds keep these objects on the heap
+#ifdef MEMTRACK_NEW
+#define ARENA_ALLOCATED_CLASS
+#else
+#define ARENA_ALLOCATED_CLASS \
+    static void* operator new(size_t size) { return Arena::allocateObject(size); } \
+    static void* operator new(size_t size, void* p) { return p; } \
+    static void operator delete(void* p, size_t size) { Arena::releaseObject(p, size); }
+#endif
+
+#endif /* _Arena_h_ */
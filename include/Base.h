@@ -115,7 +115,7 @@ extern uint64_t warnCount;
     fprintf(WARN_FILE,## __VA_ARGS__);                              \
     fprintf(WARN_FILE,"\n");                                        \
     fflush(WARN_FILE);                                              \
-    warnCount++; }
+    __sync_fetch_and_add(&warnCount, 1); }
 #else
 #define PRINT_WARN(...)
 #endif
@@ -513,9 +513,9 @@ extern FILE* GetTempFile(char** sfn);
 extern void SHA1(unsigned char * str1);
 
 //sha1 functions                                                                                                                                             
-void calc(const void *src, const int bytelength, unsigned char *hash);
+void calc(const void *src, const uint64_t bytelength, unsigned char *hash);
 void toHexString(const unsigned char *hash, char *hexstring);
-char* sha1sum(char* buffer, uint32_t size, uint64_t* first64);
+char* sha1sum(char* buffer, uint64_t size, uint64_t* first64);
 
 extern double timer();
 
@@ -26,17 +26,18 @@
 class BinaryInputFile {
 private:
     char*        inBufferPointer;
-    uint32_t     inBufferSize;
+    uint64_t     inBufferSize;
     char*        inBuffer;
 public:
     BinaryInputFile() : inBufferPointer(NULL),inBufferSize(0),inBuffer(NULL) {}
     ~BinaryInputFile();
 
     void     readFileInMemory(char* f, bool inform=true);
+    void     adviseSequential(bool sequential);
 
-    char*    copyBytes(void* buff,uint32_t bytes);
-    char*    copyBytesIterate(void* buff,uint32_t bytes);
-    char*    onlyIterate(uint32_t bytes);
+    char*    copyBytes(void* buff,uint64_t bytes);
+    char*    copyBytesIterate(void* buff,uint64_t bytes);
+    char*    onlyIterate(uint64_t bytes);
     char*    moreBytes();
 
     char*    fileOffsetToPointer(uint64_t fileOffset);
@@ -47,28 +48,41 @@ public:
 
     char*    inPtrBase() { return inBuffer; }
 
-    uint32_t alreadyRead() { return (uint32_t)(inBufferPointer-inBuffer); }
-    uint32_t bytesLeftInBuffer();
+    uint64_t alreadyRead() { return (uint64_t)(inBufferPointer-inBuffer); }
+    uint64_t bytesLeftInBuffer();
 
-    uint32_t getSize() { return inBufferSize; }
+    uint64_t getSize() { return inBufferSize; }
 
-    uint32_t currentOffset() { return (uint32_t)(inBufferPointer-inBuffer); }
+    uint64_t currentOffset() { return (uint64_t)(inBufferPointer-inBuffer); }
 };
 
 
+// the output file is assembled in memory and written with a single write when it is closed. once
+// reserve has been given the final size, writes into disjoint ranges may come from several threads
 class BinaryOutputFile {
 private:
     FILE* outFile;
     char* fileName;
+    char* tmpName;
+
+    char* image;
+    uint64_t imageSize;
+    uint64_t imageCapacity;
+    // set while parts of the image are written concurrently, when it must not be moved by growing it
+    bool fixedSize;
+
+    void growImage(uint64_t size);
 public:
 
-    BinaryOutputFile() : outFile(NULL),fileName(NULL) {}
+    BinaryOutputFile() : outFile(NULL),fileName(NULL),tmpName(NULL),image(NULL),imageSize(0),imageCapacity(0),fixedSize(false) {}
     ~BinaryOutputFile();
 
     void open(char* flnm);
     bool operator!();
-    void copyBytes(char* buffer,uint32_t size,uint32_t offset);
-    uint32_t alreadyWritten();
+    void reserve(uint64_t size);
+    void setFixedSize(bool fixed) { fixedSize = fixed; }
+    void copyBytes(char* buffer,uint64_t size,uint64_t offset);
+    uint64_t alreadyWritten();
     void close();
 };
 
@@ -95,22 +95,23 @@ void innerHash(unsigned int *result, unsigned int *w){
     result[4]+=save[4];
 }
 
-void calc(const void *src, const int bytelength, unsigned char *hash){
+void calc(const void *src, const uint64_t bytelength, unsigned char *hash){
     // Init the result array, and create references to the five unsigned integers for better readabillity.
     unsigned int result[5]={0x67452301,0xEFCDAB89,0x98BADCFE,0x10325476,0xC3D2E1F0};
 
     const unsigned char *sarray=(const unsigned char*)src;
     // The variables
     unsigned int w[80];
-    int j,i,i1;
+    uint64_t i,i1;
+    int j;
     j=0;
 
     // Loop through all complete 64byte blocks.
-    for(i=0,i1=64; i<=(bytelength-64); i=i1,i1+=64) {
+    for(i=0,i1=64; i1<=bytelength; i=i1,i1+=64) {
         int k=0;
-        for(j=i;j<i1;j+=4){
+        for(uint64_t b=i;b<i1;b+=4){
             // This line will swap endian on big endian and keep endian on little endian.
-            w[k++]=(unsigned int)sarray[j+3]|(((unsigned int)sarray[j+2])<<8)|(((unsigned int)sarray[j+1])<<16)|(((unsigned int)sarray[j])<<24);
+            w[k++]=(unsigned int)sarray[b+3]|(((unsigned int)sarray[b+2])<<8)|(((unsigned int)sarray[b+1])<<16)|(((unsigned int)sarray[b])<<24);
         }
         innerHash(result,w);
     }
@@ -126,11 +127,13 @@ void calc(const void *src, const int bytelength, unsigned char *hash){
         innerHash(result,w);
         memset(w,0,sizeof(unsigned int)*16);
     }
-    w[15]=bytelength<<3;
+    // message length in bits, 64 bits wide
+    w[14]=(unsigned int)((bytelength<<3)>>32);
+    w[15]=(unsigned int)(bytelength<<3);
     innerHash(result,w);
     // Store hash in result pointer, and make sure we get in in the correct order on both endian models.
-    for(i=20;--i>=0;){
-        hash[i]=(result[i>>2]>>(((3-i)&0x3)<<3))&0xFF;
+    for(j=20;--j>=0;){
+        hash[j]=(result[j>>2]>>(((3-j)&0x3)<<3))&0xFF;
     }
 }
 
@@ -57,12 +57,12 @@
 //#define BLOAT_MOD_OFF 0
 //#define BLOAT_MOD     2
 //#define TURNOFF_FUNCTION_BLOAT
+//#define TURNOFF_INPLACE_PROBES
 //#define SWAP_MOD_OFF 0
 //#define SWAP_MOD     2
 #define SWAP_VERBOSE
 //#define SWAP_FUNCTION_ONLY "raise"
 //#define TURNOFF_INSTRUCTION_SWAP
-#define ANCHOR_SEARCH_BINARY
 //#define PRINT_INSTRUCTION_DETAIL 
 //#define VALIDATE_ANCHOR_SEARCH
 //#define FILL_RELOCATED_WITH_INTERRUPTS
@@ -28,6 +28,8 @@
 #include <map>
 
 class AddressAnchor;
+class AddressAnchorIndex;
+class Arena;
 class BasicBlock;
 class DataReference;
 class DataSection;
@@ -80,9 +82,18 @@ private:
     DwarfLineInfoSection* lineInfoSection;
 
     Vector<AddressAnchor*>* addressAnchors;
-    bool anchorsAreSorted;
+    AddressAnchorIndex* anchorIndex;
     std::map<uint64_t, DataReference*> specialDataRefs;
 
+    // holds the instructions, operands and register sets made while this file is alive
+    Arena* arena;
+
+    // section lookup by address, valid until instrumentation starts adding and moving sections
+    Vector<uint64_t> sectionBoundaries;
+    Vector<uint16_t> sectionsAtBoundary;
+    bool sectionIndexValid;
+    void indexSections();
+
     uint16_t sectionNameStrTabIdx;
     uint16_t dynamicSymtabIdx;
     uint64_t dynamicSectionAddress;
@@ -148,7 +159,6 @@ public:
     Vector<AddressAnchor*>* getAddressAnchors() { return addressAnchors; }
     uint32_t anchorProgramElements();
     Vector<AddressAnchor*>* searchAddressAnchors(uint64_t addr);
-    void setAnchorsSorted(bool areSorted) { anchorsAreSorted = areSorted; }
 
     TextSection* getDotTextSection();
     TextSection* getDotFiniSection();
@@ -215,7 +225,8 @@ public:
     bool isWedgeAddress(uint64_t addr);
     bool isDataWedgeAddress(uint64_t addr);
 
-    uint32_t getFileSize();
+    uint64_t getFileSize();
+    uint64_t getDumpSize();
     char* getFileName() { return elfFileName; }
     char* getAppName() { return applicationName; }
 
@@ -237,6 +248,7 @@ public:
     uint16_t findSectionIdx(uint64_t addr);
     uint16_t findSectionIdx(char* name);
     RawSection* findDataSectionAtAddr(uint64_t addr);
+    void dropSectionIndex() { sectionIndexValid = false; }
     void testBitSet();
 
     uint32_t findSymbol4Addr(uint64_t addr,Symbol** buffer,uint32_t bufCnt,char** namestr=NULL);
@@ -25,6 +25,7 @@
 #include <ElfFile.h>
 #include <X86Instruction.h>
 #include <Vector.h>
+#include <map>
 
 class BasicBlock;
 class BinaryOutputFile;
@@ -105,6 +106,7 @@ private:
     uint64_t usableDataOffset;
     uint64_t regStorageOffset;
     uint64_t fxStorageOffset;
+    uint64_t xStateOffset;
     uint64_t regStorageReserved;
     uint64_t dynamicTableReserved;
     
@@ -115,6 +117,12 @@ private:
 
     LineInfoFinder* lineInfoFinder;
 
+    // block counts from a prior BasicBlockCounter run, used to lay out the extra text
+    std::map<uint64_t, uint64_t>* layoutProfile;
+
+    // symbol of each call target already resolved by findAllCalls, which is asked once per name list
+    std::map<uint64_t, Symbol*> callTargetSymbols;
+
     uint32_t addStringToDynamicStringTable(const char* str);
     uint32_t addSymbolToDynamicSymbolTable(uint32_t name, uint64_t value, uint64_t size, uint8_t bind, uint8_t type, uint32_t other, uint16_t scnidx);
     uint32_t expandHashTable(uint32_t idx);
@@ -122,6 +130,7 @@ private:
     void initializeDisabledFunctions(char* inputFuncList);
 
     void applyInstrumentationDataToRaw();
+    void generateXStateDetection(InstrumentationSnippet* snip);
     void dump(BinaryOutputFile* binaryOutputFile, uint32_t offset);
 
     void declareLibraryList();
@@ -160,6 +169,10 @@ protected:
     void computeInstrumentationOffsets();
     void compressInstrumentation(uint32_t textSize);
     uint32_t relocateAndBloatFunction(Function* functionToRelocate, uint64_t offsetToRelocation, Vector<Vector<InstrumentationPoint*>*>* functionInstPoints);
+    bool canProbeInPlace(Function* func, Vector<Vector<InstrumentationPoint*>*>* functionInstPoints);
+    void orderRelocatedFunctions(bool* needsRelocate, uint32_t* order);
+    uint64_t getLayoutCount(BasicBlock* bb);
+    bool isHotPoint(InstrumentationPoint* pt);
     bool isEligibleFunction(Function* func);
     bool is64Bit() { return elfFile->is64Bit(); }
 
@@ -184,6 +197,7 @@ public:
     ~ElfFileInst();
     ElfFile* getElfFile() { return elfFile; }
     uint64_t getRegStorageOffset() { return regStorageOffset; }
+    uint64_t getXStateOffset() { return xStateOffset; }
 
     void gatherCoverageStats(bool relocHasOccurred, const char* msg);
 
@@ -204,6 +218,7 @@ public:
 
     void setInputFunctions(char* inputFuncList);
     X86Instruction* linkInstructionToData(X86Instruction* ins, uint64_t addr, bool isOffset);
+    void materializeSnippet(InstrumentationSnippet* snip, Vector<X86Instruction*>* insns);
 
     LineInfoFinder* getLineInfoFinder() { return lineInfoFinder; }
     bool hasLineInformation() { return (lineInfoFinder != NULL); }
@@ -214,9 +229,11 @@ public:
     bool isMultiImage() { return multipleImages; }
     void setPerInstruction() { perInstruction = true; }
     bool isPerInstruction() { return perInstruction; }
+    void setLayoutProfile(char* profileFile) { layoutProfile = readBlockCounts(profileFile); }
+    std::map<uint64_t, uint64_t>* readBlockCounts(char* profileFile);
 
     char* getApplicationName() { return elfFile->getAppName(); }
-    uint32_t getApplicationSize() { return elfFile->getFileSize(); }
+    uint64_t getApplicationSize() { return elfFile->getFileSize(); }
     char* getFullFileName() { return elfFile->getFileName(); }
 
     char* getInstrumentationLibrary(uint32_t idx) { return instrumentationLibraries[idx]; }
@@ -237,6 +254,7 @@ public:
     InstrumentationFunction* declareFunction(char* funcName);
     uint32_t declareLibrary(const char* libName);
     void setLibraryList(char* libList) { libraryList = libList; }
+    bool listsLibrary(const char* libName);
 
     InstrumentationFunction* getInstrumentationFunction(const char* funcName);
     uint32_t addInstrumentationSnippet(InstrumentationSnippet* snip);
@@ -47,6 +47,8 @@ public:
 
     void setBaseAddress(uint64_t newBaseAddress);
     void computeLiveness();
+    void setLiveness(uint32_t* liveSets);
+    uint32_t packLiveness(uint32_t* liveSets);
     void computeDefUseDist();
 
     uint32_t getNumberOfInstructions();
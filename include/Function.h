@@ -29,6 +29,8 @@
 class BasicBlock;
 class BinaryInputFile;
 class BinaryOutputFile;
+class DataReference;
+struct FunctionAnalysis;
 class FlowGraph;
 class InstrumentationPoint;
 class Symbol;
@@ -42,6 +44,7 @@ private:
     const static uint32_t disasmfailMask          = 0x8;
     const static uint32_t relocatedMask           = 0x10;
     const static uint32_t manipulatedMask         = 0x20;
+    const static uint32_t probedinplaceMask       = 0x40;
 
     bool defUse;
     bool leafOpt;
@@ -56,7 +59,14 @@ protected:
     uint64_t badInstruction;
     uint64_t flags;
 
+    // jump table entries found while building the cfg, not yet handed to their data sections
+    Vector<DataReference*> jumpTableReferences;
+
+    // results of an earlier run on this binary, only valid while digesting
+    FunctionAnalysis* cachedAnalysis;
+
     Vector<X86Instruction*>* digestRecursive();
+    Vector<X86Instruction*>* digestCached();
 public:
     Function(TextSection* text, uint32_t idx, Symbol* sym, uint32_t sz);
     ~Function();
@@ -80,6 +90,7 @@ public:
     bool isDisasmFail()               { return (flags & disasmfailMask); }
     bool isRelocated()                { return (flags & relocatedMask); }
     bool isManipulated()              { return (flags & manipulatedMask); }
+    bool isProbedInPlace()            { return (flags & probedinplaceMask); }
 
     void setRecursiveDisasm()         { flags |= recursivedisasmMask; }
     void setInstrumentationFunction() { flags |= instrumentationfuncMask; }
@@ -87,6 +98,7 @@ public:
     void setDisasmFail()              { flags |= disasmfailMask; }
     void setRelocated()               { flags |= relocatedMask; }
     void setManipulated()             { flags |= manipulatedMask; }
+    void setProbedInPlace()           { flags |= probedinplaceMask; }
 
     uint64_t getBadInstruction() { return badInstruction; }
     void setBadInstruction(uint64_t addr) { badInstruction = addr; }
@@ -106,6 +118,8 @@ public:
 
     Symbol* getFunctionSymbol() { return symbol; }
     uint32_t generateCFG(Vector<X86Instruction*>* instructions, Vector<AddressAnchor*>* addressAnchors);
+    void publishDataReferences(Vector<AddressAnchor*>* addressAnchors);
+    void setCachedAnalysis(FunctionAnalysis* fa) { cachedAnalysis = fa; }
 
     FlowGraph* getFlowGraph() { return flowGraph; }
     uint32_t getNumberOfBasicBlocks();
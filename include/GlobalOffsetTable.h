@@ -22,6 +22,7 @@
 #define _GlobalOffsetTable_h_
 
 #include <RawSection.h>
+#include <map>
 
 class ElfFile;
 
@@ -34,6 +35,10 @@ protected:
     uint32_t tableBaseIdx;
 
     uint64_t* entries;
+
+    // the first entry holding each value, built on the first search and dropped when entries move
+    std::map<uint64_t, uint32_t> entryIndex;
+    bool entryIndexValid;
 public:
     GlobalOffsetTable(char* rawPtr, uint32_t size, uint16_t scnIdx, uint64_t gotSymAddr, ElfFile* elf);
     ~GlobalOffsetTable();
@@ -47,6 +52,7 @@ public:
     uint32_t getNumberOfEntries() { return numberOfEntries; }
     uint32_t minIndex() { return -1*tableBaseIdx; }
     uint32_t maxIndex() { return numberOfEntries-tableBaseIdx; }
+    bool findEntryWithValue(uint64_t value, uint32_t* idx);
     void dump(BinaryOutputFile* binaryOutputFile, uint32_t offset);
     void wedge(uint32_t shamt);
 };
@@ -41,9 +41,22 @@ class InstrumentationPoint;
 #define Size__32_bit_procedure_link 16
 #define Size__64_bit_procedure_link 16
 #define Size__32_bit_function_wrapper 128
-#define Size__64_bit_function_wrapper 256
+#define Size__64_bit_function_wrapper 512
+
+// a wrapper save set has one bit per GPR plus these
+#define WrapperSave_Flags (1 << X86_64BIT_GPRS)
+#define WrapperSave_FP    (1 << (X86_64BIT_GPRS + 1))
+#define WrapperSave_All   ((1 << (X86_64BIT_GPRS + 2)) - 1)
 
 #define FXSTORAGE_RESERVED 0x1000
+
+// xsave components kept across instrumentation calls: x87, SSE, AVX and the AVX-512 opmask/ZMM_Hi256/Hi16_ZMM state.
+// the processor masks this with XCR0, and the standard format area for all of it (2688 bytes) fits in the aligned stack area
+#define XSTATE_FEATURE_MASK 0xe7
+#define XSTATE_AREA_SIZE 2688
+// the 64-byte xsave header follows the 512-byte legacy region
+#define XSTATE_HEADER_OFFSET 512
+#define XSTATE_HEADER_SIZE 64
 #define Size__trampoline_stackalign 0x1000
 #define Size__trampoline_autoinc 0x80
 #define Size__near_call_stack_inc 0x08
@@ -52,6 +65,7 @@ class InstrumentationPoint;
 #define Size__64_bit_inst_function_call_support 5
 
 #define Size__uncond_jump 5
+#define Size__cond_jump 6
 #define Size__flag_protect_full 2
 
 #ifdef THREAD_SAFE
@@ -75,6 +89,109 @@ class InstrumentationPoint;
 extern Vector<InstrumentationPoint*>* instpointFilterAddressRange(Base* object, Vector<InstrumentationPoint*>* instPoints);
 
 
+enum TemplateFieldTypes {
+    TemplateField_immediate = 0,
+    TemplateField_displacement,
+    TemplateField_dataLink,
+    TemplateField_Total_Types
+};
+
+// a snippet shape that is encoded and disassembled once. the template keeps the encoded bytes along with
+// where each field sits in them, so a use is written out by copying the bytes and patching in its values.
+// the prototype instructions stay around for register analysis and for the few places that need real
+// instructions (see instantiate)
+class SnippetTemplate {
+private:
+    Vector<X86Instruction*> prototypes;
+    char* bytes;
+    uint32_t sizeInBytes;
+
+    Vector<uint32_t> fieldInstructions;
+    Vector<uint32_t> fieldOperands;
+    Vector<uint32_t> fieldTypes;
+    Vector<uint32_t> fieldOffsets;
+    Vector<uint32_t> fieldBytes;
+    // end of the field's instruction, which a data link is relative to
+    Vector<uint32_t> fieldEnds;
+
+    // the same template with a register renamed, made the first time a use asks for it
+    Vector<uint32_t> renameKeys;
+    Vector<SnippetTemplate*> renamedTemplates;
+
+    uint32_t addField(uint32_t inst, uint32_t operandType, uint32_t fieldType);
+
+public:
+    SnippetTemplate();
+    ~SnippetTemplate();
+
+    uint32_t addInstruction(X86Instruction* proto);
+    uint32_t addImmediate(uint32_t inst);
+    uint32_t addDisplacement(uint32_t inst);
+    uint32_t addDataLink(uint32_t inst);
+
+    uint32_t getNumberOfInstructions() { return prototypes.size(); }
+    X86Instruction* getPrototype(uint32_t idx) { return prototypes[idx]; }
+    uint32_t getNumberOfFields() { return fieldTypes.size(); }
+    uint32_t getFieldType(uint32_t idx) { return fieldTypes[idx]; }
+    uint32_t getFieldInstruction(uint32_t idx) { return fieldInstructions[idx]; }
+    uint32_t getSizeInBytes() { return sizeInBytes; }
+
+    SnippetTemplate* getRenamed(uint32_t from, uint32_t to);
+    void dump(BinaryOutputFile* binaryOutputFile, uint32_t offset, uint64_t addr, uint64_t* values);
+    Vector<X86Instruction*>* instantiate(uint64_t* values);
+};
+
+// one use of a SnippetTemplate, which is the template's bytes with this use's values patched in
+class TemplateInstance {
+private:
+    SnippetTemplate* snippetTemplate;
+    uint64_t* values;
+    uint64_t baseAddress;
+
+public:
+    TemplateInstance(SnippetTemplate* t, uint64_t* vals);
+    ~TemplateInstance();
+
+    SnippetTemplate* getTemplate() { return snippetTemplate; }
+    uint64_t* getValues() { return values; }
+    uint32_t getSizeInBytes() { return snippetTemplate->getSizeInBytes(); }
+    void setBaseAddress(uint64_t addr) { baseAddress = addr; }
+    bool renameRegister(uint32_t from, uint32_t to);
+    void dump(BinaryOutputFile* binaryOutputFile, uint32_t offset);
+};
+
+// generated code in order, each piece being either an instruction or a template instance. instances stay
+// bytes until they are written out, ElfFileInst::materializeSnippet makes instructions of them for code
+// that is placed inside a function
+class CodeSequence {
+private:
+    Vector<X86Instruction*> instructions;
+    Vector<TemplateInstance*> instances;
+
+public:
+    uint32_t size() { return instructions.size(); }
+    bool isInstance(uint32_t idx) { return (instances[idx] != NULL); }
+    X86Instruction* getInstruction(uint32_t idx) { ASSERT(instructions[idx]); return instructions[idx]; }
+    TemplateInstance* getInstance(uint32_t idx) { ASSERT(instances[idx]); return instances[idx]; }
+    X86Instruction* back() { return getInstruction(size() - 1); }
+
+    void append(X86Instruction* ins);
+    void append(TemplateInstance* ti);
+    void prepend(X86Instruction* ins);
+    void replace(X86Instruction* ins, X86Instruction* rep);
+    uint32_t moveTo(CodeSequence* dest);
+    void clear();
+    void destroy();
+
+    uint32_t getSizeInBytes(uint32_t idx);
+    uint32_t getSizeInBytes();
+    void getInstructions(Vector<X86Instruction*>* insns);
+    bool renameRegister(uint32_t from, uint32_t to);
+    uint32_t relaxBranches();
+    void setBaseAddress(uint64_t addr);
+    void dump(BinaryOutputFile* binaryOutputFile, uint32_t offset, uint64_t addr);
+};
+
 class Instrumentation : public Base {
 protected:
     Vector<X86Instruction*> bootstrapInstructions;
@@ -116,13 +233,21 @@ public:
 
 class InstrumentationSnippet : public Instrumentation {
 private:
-    Vector<X86Instruction*> snippetInstructions;
+    CodeSequence snippetCode;
     uint64_t snippetOffset;
 
     uint32_t numberOfDataEntries;
     uint32_t* dataEntrySizes;
     uint64_t* dataEntryOffsets;
 
+    // gprs the snippet only uses as scratch, these are moved onto dead registers at placement time
+    uint32_t virtualRegisters;
+    // gprs that scratch registers are never put on, even where they look dead
+    uint32_t reservedRegisters;
+
+    // instructions that compute an application address from %rsp, which state protection moves
+    Vector<X86Instruction*> stackAddresses;
+
 public:
     InstrumentationSnippet();
     ~InstrumentationSnippet();    
@@ -141,19 +266,34 @@ public:
 
     uint64_t getEntryPoint();
 
-    uint32_t getNumberOfCoreInstructions() { return snippetInstructions.size(); }
-    X86Instruction* getCoreInstruction(uint32_t idx) { ASSERT(snippetInstructions[idx]); return snippetInstructions[idx]; }
-    X86Instruction* removeNextCoreInstruction() { ASSERT(hasMoreCoreInstructions()); return snippetInstructions.remove(0); }
-    bool hasMoreCoreInstructions() { return (snippetInstructions.size() != 0); }
-    void appendCoreInstruction(X86Instruction* ins) { snippetInstructions.append(ins); }
-    void prependCoreInstruction(X86Instruction* ins) { snippetInstructions.insert(ins, 0); }
+    CodeSequence* getSnippetCode() { return &snippetCode; }
+    void appendCoreInstruction(X86Instruction* ins) { snippetCode.append(ins); }
+    void prependCoreInstruction(X86Instruction* ins) { snippetCode.prepend(ins); }
 
     uint32_t addSnippetInstruction(X86Instruction* inst);
+    uint32_t addSnippetTemplate(TemplateInstance* ti);
+    uint32_t addStackAddressInstruction(X86Instruction* inst);
+    void shiftStackAddresses(uint32_t depth);
+    uint32_t addVirtualRegister(BitSet<uint32_t>* unusableRegs);
+    uint32_t addVirtualRegister(BitSet<uint32_t>* unusableRegs, BitSet<uint32_t>* preferredRegs);
+    bool isVirtualRegister(uint32_t reg) { return (reg < X86_64BIT_GPRS && (virtualRegisters & (1 << reg))); }
+    bool hasVirtualRegisters() { return (virtualRegisters != 0); }
+    void reserveRegister(uint32_t reg) { ASSERT(reg < X86_64BIT_GPRS && !isVirtualRegister(reg)); reservedRegisters |= (1 << reg); }
+    bool isReservedRegister(uint32_t reg) { return (reg < X86_64BIT_GPRS && (reservedRegisters & (1 << reg))); }
+    bool renameVirtualRegister(uint32_t reg, uint32_t phys);
     void setCodeOffset(uint64_t off) { snippetOffset = off; }
     uint64_t getCodeOffset() { return snippetOffset; }
 
 };
 
+// which save instruction the wrappers use, chosen by the bootstrap code at runtime
+typedef enum {
+    XStateMode_fxsave = 0,
+    XStateMode_xsave,
+    XStateMode_xsavec,
+    XStateMode_TotalTypes
+} XStateModes;
+
 typedef enum {
     ArgumentType_Undefined = 0,
     ArgumentType_Address,
@@ -183,6 +323,11 @@ protected:
     Vector<X86Instruction*> wrapperInstructions;
     uint64_t wrapperOffset;
 
+    // one wrapper is generated per distinct save set, variant 0 saves everything
+    Vector<uint32_t> wrapperSaveSets;
+    // offset of each variant from wrapperOffset
+    Vector<uint32_t> wrapperEntries;
+
     uint32_t globalData;
     uint64_t globalDataOffset;
 
@@ -245,6 +390,9 @@ public:
     uint64_t getEntryPoint();
 
     void setWrapperOffset(uint64_t off) { wrapperOffset = off; }
+    uint32_t addWrapperVariant(uint32_t saveSet);
+    uint32_t getNumberOfWrapperVariants() { return wrapperSaveSets.size(); }
+    uint64_t getWrapperEntryPoint(uint32_t variant) { ASSERT(variant < wrapperEntries.size()); return wrapperOffset + wrapperEntries[variant]; }
     void setProcedureLinkOffset(uint64_t off) { procedureLinkOffset = off; }
 };
 
@@ -264,6 +412,11 @@ public:
 };
 
 class InstrumentationFunction64 : public InstrumentationFunction {
+private:
+    void appendWrapperInstructions(Vector<X86Instruction*>& insns);
+    void appendXStateSave(ElfFileInst* elfInst);
+    void appendXStateRestore(ElfFileInst* elfInst);
+
 public:
     InstrumentationFunction64(uint32_t idx, char* funcName,uint64_t dataoffset, uint64_t fEntry) : InstrumentationFunction(idx,funcName,dataoffset,fEntry) {}
     ~InstrumentationFunction64() {}
@@ -335,7 +488,7 @@ protected:
     InstLocations instLocation;
     int32_t offsetFromPoint;
 
-    Vector<X86Instruction*> trampolineInstructions;
+    CodeSequence trampolineInstructions;
     uint64_t trampolineOffset;
 
     InstPriorities priority;
@@ -344,9 +497,16 @@ protected:
     FlagsProtectionMethods protectionMethod;
     BitSet<uint32_t>* deadRegs;
 
-    Vector<X86Instruction*> precursorInstructions;
+    uint32_t wrapperVariant;
+    uint32_t preservedRegs;
+
+    bool dynamic;
+
+    CodeSequence precursorInstructions;
     Vector<X86Instruction*> postcursorInstructions;
 
+    Vector<X86Instruction*>* getPointInstructions();
+
 public:
 
     InstrumentationPoint(Base* pt, Instrumentation* inst, InstrumentationModes instMode, InstLocations loc);
@@ -365,9 +525,18 @@ public:
 
     FlagsProtectionMethods getFlagsProtectionMethod();
     BitSet<uint32_t>* getProtectedRegisters();
+    BitSet<uint32_t>* getTouchedRegisters();
+    bool isRegDeadAtPoint(uint32_t reg);
+    bool needsLightFlagsScratch();
+    uint32_t assignVirtualRegisters();
     void setFlagsProtectionMethod(FlagsProtectionMethods p);
 
-    uint64_t getTargetOffset() { ASSERT(instrumentation); return instrumentation->getEntryPoint(); }
+    uint64_t getTargetOffset();
+    uint32_t getWrapperSaveSet();
+    void preserveRegister(uint32_t reg) { ASSERT(reg < X86_64BIT_GPRS); preservedRegs |= (1 << reg); }
+    void setWrapperVariant(uint32_t v) { wrapperVariant = v; }
+    void setDynamic() { dynamic = true; }
+    bool isDynamic() { return dynamic; }
     Instrumentation* getInstrumentation() { return instrumentation; }
 
     X86Instruction* getSourceObject() { return point; }
@@ -383,16 +552,13 @@ public:
          { __SHOULD_NOT_ARRIVE; }
     uint64_t getTrampolineOffset() { return trampolineOffset; }
 
-    X86Instruction* removeNextPrecursorInstruction() { ASSERT(hasMorePrecursorInstructions()); return precursorInstructions.remove(0); }
-    bool hasMorePrecursorInstructions() { return (precursorInstructions.size() != 0); }
     uint32_t addPrecursorInstruction(X86Instruction* inst);
+    uint32_t addPrecursorTemplate(TemplateInstance* ti);
     X86Instruction* removeNextPostcursorInstruction() { ASSERT(hasMorePostcursorInstructions()); return postcursorInstructions.remove(0); }
     bool hasMorePostcursorInstructions() { return (postcursorInstructions.size() != 0); }
     uint32_t addPostcursorInstruction(X86Instruction* inst);
 
-    uint32_t countPrecursorInstructions() { return precursorInstructions.size(); }
     uint32_t countPostcursorInstructions() { return postcursorInstructions.size(); }
-    X86Instruction* getPrecursorInstruction(uint32_t i) { return precursorInstructions[i]; }
     X86Instruction* getPostcursorInstruction(uint32_t i) { return postcursorInstructions[i]; }
 
     bool verify();
@@ -51,9 +51,29 @@ struct DynamicInstInternal {
     }
 };
 
+// snippet shapes that are kept as templates
+enum SnippetShapes {
+    SnippetShape_threadData = 0,
+    SnippetShape_threadTripCounter,
+    SnippetShape_tripCounter,
+    SnippetShape_ripTripCounter,
+    SnippetShape_saturationCheck,
+    SnippetShape_bufferCheck,
+    SnippetShape_bufferIncrement,
+    SnippetShape_bufferFill,
+    SnippetShape_bufferFillLast,
+    SnippetShape_bufferEntry,
+    SnippetShape_Total_Types
+};
+// a template is specific to its shape, the register holding thread data (if any) and its scratch registers
+#define SNIPPET_TEMPLATE_KEY(__shape, __treg, __r1, __r2, __r3) \
+    (((uint64_t)(__shape) << 32) | ((uint64_t)((__treg) & 0xff) << 24) | ((uint64_t)((__r1) & 0xff) << 16) | \
+     ((uint64_t)((__r2) & 0xff) << 8) | (uint64_t)((__r3) & 0xff))
+
 class InstrumentationTool : public ElfFileInst {
 private:
     char* extension;
+    std::map<uint64_t, SnippetTemplate*> snippetTemplates;
     bool singleArgCheck(void* arg, uint32_t mask, const char* name);
     bool hasThreadEvidence();
 
@@ -70,12 +90,23 @@ protected:
     InstrumentationPoint* insertBlockCounter(uint64_t, Base*, bool, uint32_t);
     InstrumentationPoint* insertBlockCounter(uint64_t, Base*, bool, uint32_t, uint32_t);
     InstrumentationPoint* insertInlinedTripCounter(uint64_t, X86Instruction*, bool, uint32_t, InstLocations, BitSet<uint32_t>*, uint32_t val);
+    InstrumentationPoint* insertInlinedRegisterSum(uint64_t counterOffset, X86Instruction* bestinst, uint32_t reg, bool signExtend, uint32_t threadReg, InstLocations loc, bool beforeReturn);
+    InstrumentationPoint* insertInlinedTimer(uint64_t timerOffset, uint64_t accumOffset, uint64_t lastOffset, uint64_t visitOffset, X86Instruction* bestinst, InstLocations loc, bool start);
+    InstrumentationPoint* insertInlinedTimer(uint64_t timerOffset, uint64_t accumOffset, uint64_t lastOffset, uint64_t visitOffset, uint64_t depthOffset, X86Instruction* bestinst, InstLocations loc, bool start);
+    InstrumentationPoint* insertInlinedTimer(uint64_t timerOffset, uint64_t accumOffset, uint64_t lastOffset, uint64_t visitOffset, bool nested, uint64_t depthOffset, X86Instruction* bestinst, InstLocations loc, bool start);
+
+    uint64_t reserveHardwareCounters(uint64_t regionCount);
 
     void assignStoragePrior(InstrumentationPoint* pt, uint32_t value, uint64_t address, uint8_t tmpreg, uint64_t regbak);
     void assignStoragePrior(InstrumentationPoint* pt, uint32_t value, uint8_t reg);
 
-    Vector<X86Instruction*>* storeThreadData(uint32_t scratch, uint32_t dest);
-    Vector<X86Instruction*>* storeThreadData(uint32_t scratch, uint32_t dest, bool storeToStack, uint32_t stackPatch);
+    TemplateInstance* storeThreadData(uint32_t scratch, uint32_t dest);
+    TemplateInstance* storeThreadData(uint32_t scratch, uint32_t dest, bool storeToStack, uint32_t stackPatch);
+    void addThreadDataTemplate(SnippetTemplate* t, uint32_t scratch, uint32_t dest);
+
+    SnippetTemplate* getSnippetTemplate(uint64_t key);
+    SnippetTemplate* addSnippetTemplate(uint64_t key);
+    TemplateInstance* instantiateSnippetTemplate(SnippetTemplate* t, uint64_t* values);
     void threadAllEntryPoints(Function* f, uint32_t threadReg);
 
     std::map<uint64_t, uint32_t>* threadReadyCode(std::set<Base*>& objectsToInst);
@@ -92,6 +123,11 @@ protected:
     char* dfpFile;
     char* trackFile;
     bool doIntro;
+    bool hwCounters;
+    bool edgeCounters;
+    bool inductionCounters;
+    bool callingContext;
+    uint64_t saturationLimit;
 
 #define PEBIL_OPT_ALL 0xffffffff
 #define PEBIL_OPT_NON 0x00000000
@@ -102,6 +138,11 @@ protected:
 #define PEBIL_OPT_DFP 0x00000010
 #define PEBIL_OPT_TRK 0x00000020
 #define PEBIL_OPT_DOI 0x00000040
+#define PEBIL_OPT_HWC 0x00000080
+#define PEBIL_OPT_EDG 0x00000100
+#define PEBIL_OPT_SAT 0x00000200
+#define PEBIL_OPT_NOI 0x00000400
+#define PEBIL_OPT_CCT 0x00000800
 
     Vector<DynamicInstInternal*> dynamicPoints;
     InstrumentationFunction* dynamicInit;
@@ -111,10 +152,10 @@ protected:
 
 public:
     InstrumentationTool(ElfFile* elf);
-    virtual ~InstrumentationTool() { }
+    virtual ~InstrumentationTool();
 
     void init(char* ext);
-    void initToolArgs(bool lpi, bool dtl, bool doi, uint32_t phase, char* inp, char* dfp, char* trk);
+    void initToolArgs(bool lpi, bool dtl, bool doi, bool hwc, bool edg, bool noi, bool cct, uint64_t sat, uint32_t phase, char* inp, char* dfp, char* trk);
 
     virtual void declare();
     virtual void instrument();
@@ -57,6 +57,12 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <Base.h>
 #ifdef DEBUG_MEMTRACK
 #include <typeinfo>
+// the standard headers use placement new, so they must be seen before new is redefined below
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
 
 namespace MemTrack
 {
@@ -47,6 +47,7 @@ public:
 
     uint64_t getBaseAddress(); 
     uint64_t getSectionOffset() { return sectionOffset; }
+    RawSection* getRawSection() { return rawSection; }
     void initializeAnchor(Base* link);
     AddressAnchor* getAddressAnchor() { return addressAnchor; }
     uint64_t getData() { return data; }
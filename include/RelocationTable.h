@@ -25,6 +25,7 @@
 #include <RawSection.h>
 #include <defines/RelocationTable.d>
 #include <Vector.h>
+#include <map>
 
 class ElfFile;
 class SectionHeader;
@@ -125,6 +126,10 @@ protected:
     uint32_t relocationSize;
 
     Vector<Relocation*> relocations;
+
+    // the first relocation at each offset, built on the first search and dropped when offsets move
+    std::map<uint64_t, uint32_t> offsetIndex;
+    bool offsetIndexValid;
 public:
 
     RelocationTable(char* rawPtr, uint64_t size, uint16_t scnIdx, uint32_t idx, ElfFile* elf);
@@ -138,6 +143,7 @@ public:
 
     uint32_t getNumberOfRelocations() { return relocations.size(); }
     Relocation* getRelocation(uint32_t idx) { return relocations[idx]; }
+    Relocation* findRelocationAtOffset(uint64_t offset);
 
     ElfFile* getElfFile() { return elfFile; }
     uint32_t getIndex() { return index; }
@@ -97,6 +97,13 @@ protected:
     uint32_t index;
     Vector<TextObject*> sortedTextObjects;
 
+    // the functions of sortedTextObjects with the highest end address seen up to each of them. functions
+    // can overlap, so the first one whose running end passes an address is the first that can hold it
+    Vector<Function*> functionTable;
+    Vector<uint64_t> functionTableEnds;
+    bool functionTableValid;
+    void buildFunctionTable();
+
     ByteSources source;
 public:
     TextSection(char* filePtr, uint64_t size, uint16_t scnIdx, uint32_t idx, ElfFile* elf, ByteSources src);
@@ -125,6 +132,7 @@ public:
 
     void dump (BinaryOutputFile* binaryOutputFile, uint32_t offset);
 
+    Function* getFunctionAtAddress(uint64_t addr);
     BasicBlock* getBasicBlockAtAddress(uint64_t addr);
     X86Instruction* getInstructionAtAddress(uint64_t addr);
     uint32_t getAllInstructions(X86Instruction** allinsts, uint32_t nexti);
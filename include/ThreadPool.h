@@ -0,0 +1,66 @@
+/*
+ * This file is part of the pebil project.
+ *
+ * Copyright (c) 2010, University of California Regents
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ThreadPool_h_
+#define _ThreadPool_h_
+
+#include <Base.h>
+#include <pthread.h>
+#include <deque>
+
+typedef void (*ThreadPoolTask)(void* item);
+
+// runs a batch of independent tasks on a fixed number of threads. the tasks are dealt out largest first
+// to a queue per thread, each thread works from the front of its own queue then steals from the back of
+// the others. anything the tasks share must be merged by the caller after run returns
+class ThreadPool {
+private:
+    struct TaskQueue {
+        pthread_mutex_t lock;
+        std::deque<void*> items;
+    };
+    struct Worker {
+        ThreadPool* pool;
+        uint32_t self;
+    };
+
+    uint32_t numberOfThreads;
+    TaskQueue* queues;
+    ThreadPoolTask task;
+
+    static uint32_t defaultThreads;
+
+    static void* workerMain(void* arg);
+    void work(uint32_t self);
+    bool nextItem(uint32_t self, void** item);
+
+public:
+    ThreadPool(uint32_t threads);
+    ~ThreadPool();
+
+    uint32_t getNumberOfThreads() { return numberOfThreads; }
+    void run(Vector<void*>& items, Vector<uint64_t>& costs, ThreadPoolTask t);
+
+    static void setDefaultThreads(uint32_t threads);
+    static uint32_t getDefaultThreads();
+    static void runTasks(Vector<void*>& items, Vector<uint64_t>& costs, ThreadPoolTask t);
+};
+
+#endif /* _ThreadPool_h_ */
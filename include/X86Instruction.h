@@ -22,6 +22,7 @@
 #define _X86Instruction_h_
 
 #include <AddressAnchor.h>
+#include <Arena.h>
 #include <Base.h>
 #include <BitSet.h>
 #include <LinkedList.h>
@@ -188,10 +189,12 @@ const static char* alu_name_map[X86_ALU_REGS] = { "ax", "cx", "dx", "bx", "sp",
                                                   "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15",
                                                   "st0", "st1", "st2", "st3", "st4", "st5", "st6", "st7" };
 
+// flags then registers, one bit each, held in 64-bit words so the set operations and counts
+// take a handful of word operations
 class RegisterSet {
 public:
-    RegisterSet();
-    RegisterSet& operator=(const RegisterSet& rhs);
+    RegisterSet() { bzero(words, sizeof(words)); }
+    RegisterSet& operator=(const RegisterSet& rhs) { memcpy(words, rhs.words, sizeof(words)); return *this; }
     RegisterSet& operator|=(const RegisterSet& rhs);
     const RegisterSet operator|(const RegisterSet& rhs);
     RegisterSet& operator-=(const RegisterSet& rhs);
@@ -201,12 +204,52 @@ public:
     void addFlag(uint32_t flagNum);
     bool containsFlag(uint32_t flagNum);
     bool containsRegister(uint32_t regNum);
+    uint32_t countFlags();
+    uint32_t countRegisters();
     void print(const char * const name);
 
+    // in = use | (out - def), done a word at a time
+    void setTransfer(const RegisterSet& use, const RegisterSet& out, const RegisterSet& def){
+        for (uint32_t i = 0; i < SetWords; i++){
+            words[i] = use.words[i] | (out.words[i] & ~def.words[i]);
+        }
+    }
+
+    // fixed size form of the set, flags first then registers
+    const static uint32_t PackedWords = (X86_FLAG_BITS + X86_ALU_REGS + 31) / 32;
+    void pack(uint32_t* packed);
+    void unpack(uint32_t* packed);
+
+    ARENA_ALLOCATED_CLASS
+
 private:
-    BitSet<uint32_t> regs;
+    const static uint32_t SetWords = (X86_FLAG_BITS + X86_ALU_REGS + 63) / 64;
+    uint64_t words[SetWords];
 };
 
+inline RegisterSet& RegisterSet::operator|=(const RegisterSet& rhs){
+    for (uint32_t i = 0; i < SetWords; i++){
+        words[i] |= rhs.words[i];
+    }
+    return *this;
+}
+
+inline RegisterSet& RegisterSet::operator-=(const RegisterSet& rhs){
+    for (uint32_t i = 0; i < SetWords; i++){
+        words[i] &= ~rhs.words[i];
+    }
+    return *this;
+}
+
+inline bool RegisterSet::operator==(const RegisterSet& rhs){
+    for (uint32_t i = 0; i < SetWords; i++){
+        if (words[i] != rhs.words[i]){
+            return false;
+        }
+    }
+    return true;
+}
+
 #define X86_SEGREG_ES 0
 #define X86_SEGREG_CS 1
 #define X86_SEGREG_SS 2
@@ -251,7 +294,7 @@ struct ud_compact
     uint64_t		insn_offset;
     char		insn_bytes[16];
     //char		insn_hexcode[32];
-    char		insn_buffer[INSTRUCTION_PRINT_SIZE];
+    //char		insn_buffer[INSTRUCTION_PRINT_SIZE];
     //unsigned int	insn_fill;
     //uint8_t		dis_mode;
     //uint64_t		pc;
@@ -376,9 +419,10 @@ extern uint32_t regbase_to_type(uint32_t base);
 
 class X86InstructionClassifier;
 
+// the operand fields are those of the owning instruction rather than a copy of them
 class OperandX86 {
 private:
-    struct ud_operand entry;
+    struct ud_operand& entry;
     X86Instruction* instruction;
     uint32_t operandIndex;
 
@@ -388,6 +432,8 @@ public:
     OperandX86(X86Instruction* inst, struct ud_operand* init, uint32_t idx);
     ~OperandX86() {}
 
+    ARENA_ALLOCATED_CLASS
+
     X86Instruction* getInstruction() { return instruction; }
     bool isSameOperand(OperandX86* other);
 
@@ -418,12 +464,9 @@ private:
     RegisterSet* liveOuts;
     uint32_t defUseDist;
 
-    uint32_t* flags_usedef;
-
-    OperandX86** operands;
+    OperandX86* operands[MAX_OPERANDS];
     uint32_t instructionIndex;
 
-    char* rawBytes;
     uint8_t byteSource;
     uint64_t programAddress;
     AddressAnchor* addressAnchor;
@@ -452,8 +495,11 @@ public:
 
     X86Instruction(TextObject* cont, uint64_t baseAddr, char* buff, uint8_t src, uint32_t idx);
     X86Instruction(TextObject* cont, uint64_t baseAddr, char* buff, uint8_t src, uint32_t idx, bool is64bit, uint32_t sz);
+    X86Instruction(X86Instruction* proto);
     ~X86Instruction();
 
+    ARENA_ALLOCATED_CLASS
+
     static void initBlankUd(bool is64Bit);
 
     OperandX86* getOperand(uint32_t idx);
@@ -511,12 +557,15 @@ public:
     void print();
     bool verify();
 
-    char* charStream() { return rawBytes; }
+    char* charStream() { return GET(insn_bytes); }
+    void getAssembly(char* text);
 
     HashCode* generateHashCode(BasicBlock* bb);
 
     void setLiveIns(RegisterSet* live);
     void setLiveOuts(RegisterSet* live);
+    RegisterSet* getLiveIns() { return liveIns; }
+    RegisterSet* getLiveOuts() { return liveOuts; }
 
     void setBaseAddress(uint64_t addr) { baseAddress = addr; cacheBaseAddress = addr; }
     uint32_t getSizeInBytes() { return sizeInBytes; }
@@ -533,6 +582,9 @@ public:
     void usesRegisters(BitSet<uint32_t>* regs);
     void defsRegisters(BitSet<uint32_t>* regs);
     void touchedRegisters(BitSet<uint32_t>* regs);
+    bool renameRegister(uint32_t from, uint32_t to);
+    uint32_t getOperandField(uint32_t idx, uint32_t* bytes);
+    void setOperandValue(uint32_t idx, uint64_t value);
     bool controlFallsThrough();
 
     // control instruction id
@@ -44,6 +44,8 @@ public:
     static X86Instruction* emitBranchJNE(uint64_t offset);
     static X86Instruction* emitJumpRelative(uint64_t addr, uint64_t tgt);
     static X86Instruction* emitCallRelative(uint64_t addr, uint64_t tgt);
+    static uint32_t relaxBranches(Vector<X86Instruction*>& insts, uint32_t first);
+    static uint32_t relaxBranches(Vector<X86Instruction*>& insts, uint32_t first, uint32_t* fixedSizes);
     static X86Instruction* emitReturn();
 
     static X86Instruction* emitSetDirectionFlag(bool backward);
@@ -70,6 +72,9 @@ public:
 
     static X86Instruction* emitStoreAHToFlags();
     static X86Instruction* emitLoadAHFromFlags();
+    static X86Instruction* emitReadTimestampCounter();
+    static X86Instruction* emitCpuid();
+    static X86Instruction* emitXGetBV();
 
     static X86Instruction* emitMoveImmToRegaddrImm(uint64_t immval, uint32_t idx, uint64_t immoff);
 };
@@ -86,6 +91,8 @@ private:
 
     static X86Instruction* emitRegAddImm4Byte(uint8_t idx, uint32_t imm);
 
+    static X86Instruction* emitXStateReg(uint8_t reg, uint8_t op, uint8_t ext);
+
 public:
     static X86Instruction* assemble(const char* buf);
 
@@ -95,6 +102,10 @@ public:
     static X86Instruction* emitFxRstor(uint64_t addr);
     static X86Instruction* emitFxSaveReg(uint8_t reg);
     static X86Instruction* emitFxRstorReg(uint8_t reg);
+    static X86Instruction* emitXSaveReg(uint8_t reg);
+    static X86Instruction* emitXSaveOptReg(uint8_t reg);
+    static X86Instruction* emitXSaveCReg(uint8_t reg);
+    static X86Instruction* emitXRstorReg(uint8_t reg);
 
     static X86Instruction* emitMoveTLSOffsetToReg(uint32_t imm, uint8_t dest);
     static X86Instruction* emitMoveThreadIdToReg(uint8_t dest);
@@ -109,6 +120,11 @@ public:
     static X86Instruction* emitRegSubImm(uint8_t, uint32_t);
     static X86Instruction* emitMoveRegToRegaddrImm(uint32_t, uint32_t, uint64_t, bool);
     static X86Instruction* emitMoveRegaddrImmToReg(uint32_t, uint64_t, uint32_t);
+    static X86Instruction* emitAddRegToRegaddrImm(uint32_t idxsrc, uint32_t idxdest, uint64_t imm);
+    static X86Instruction* emitSubRegaddrImmFromReg(uint32_t idxsrc, uint64_t imm, uint32_t idxdest);
+    static X86Instruction* emitCondMoveNERegaddrImmToReg(uint32_t idxsrc, uint64_t imm, uint32_t idxdest);
+    static X86Instruction* emitCompareImmByteRegaddrImm(uint8_t byte, uint32_t idx, uint64_t imm);
+    static X86Instruction* emitIncrementRegaddrImm(uint32_t idx, uint64_t imm);
     static X86Instruction* emitMoveImmToReg(uint64_t imm, uint32_t idx);
     static X86Instruction* emitMoveImm64ToReg(uint64_t imm, uint32_t idx);
     static X86Instruction* emitMoveRegToRegaddr(uint32_t idxsrc, uint32_t idxdest);
@@ -133,6 +149,7 @@ public:
     static X86Instruction* emitRegImmMultReg(uint32_t src, uint32_t imm, uint32_t dest);
     static X86Instruction* emitLoadRipImmToReg(uint32_t imm, uint32_t destreg);
     static X86Instruction* emitMoveRegToReg(uint32_t srcreg, uint32_t destreg);
+    static X86Instruction* emitMoveSignExtendRegToReg(uint32_t srcreg, uint32_t destreg);
     static X86Instruction* emitLoadRegImmReg(uint8_t src, uint64_t imm, uint8_t dest);
     static X86Instruction* emitLoadRipImmReg(uint64_t imm, uint8_t dest);
 
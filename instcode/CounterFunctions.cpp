@@ -30,6 +30,7 @@
 #include <string.h>
 #include <dlfcn.h>
 #include <signal.h>
+#include <math.h>
 
 #define PRINT_MINIMUM 1
 
@@ -48,6 +49,8 @@ void print_loop_array(FILE* stream, CounterArray* ctrs){
             continue;
         } else if (ctrs->Types[i] == CounterType_loop){
             idx = i;
+        } else if (ctrs->Types[i] == CounterType_edge || ctrs->Types[i] == CounterType_induction){
+            continue;
         } else {
             assert(false && "unsupported counter type");
         }
@@ -76,7 +79,7 @@ void print_counter_array(FILE* stream, CounterArray* ctrs){
             idx = i;
         } else if (ctrs->Types[i] == CounterType_instruction){
             idx = ctrs->Counters[i];
-        } else if (ctrs->Types[i] == CounterType_loop){
+        } else if (ctrs->Types[i] == CounterType_loop || ctrs->Types[i] == CounterType_edge || ctrs->Types[i] == CounterType_induction){
             continue;
         } else {
             assert(false && "unsupported counter type");
@@ -94,6 +97,145 @@ void print_counter_array(FILE* stream, CounterArray* ctrs){
     fflush(stream);
 }
 
+// spanning tree mode (--edg): only chords of each function's spanning tree are counted. solve the tree edges
+// by flow conservation, peeling vertices with a single unknown edge, then a block's count is its inflow.
+// depends only on the chord counters so it may be repeated
+void ReconstructEdgeCounts(CounterArray* ctrs){
+    if (ctrs == NULL || ctrs->EdgeCount == 0){
+        return;
+    }
+
+    uint32_t first = 0;
+    while (first < ctrs->EdgeCount){
+        uint32_t last = first;
+        while (last < ctrs->EdgeCount && ctrs->Edges[last].Group == ctrs->Edges[first].Group){
+            last++;
+        }
+
+        uint32_t count = last - first;
+        vector<uint64_t> values(count, 0);
+        vector<bool> known(count, false);
+        map<uint32_t, vector<uint32_t> > incident;
+        map<uint32_t, uint32_t> unknown;
+
+        for (uint32_t i = 0; i < count; i++){
+            CounterEdge* e = &ctrs->Edges[first + i];
+            incident[e->Source].push_back(i);
+            if (e->Target != e->Source){
+                incident[e->Target].push_back(i);
+            }
+            if (e->Counter == CounterEdge_tree){
+                unknown[e->Source]++;
+                unknown[e->Target]++;
+            } else {
+                values[i] = ctrs->Counters[e->Counter];
+                known[i] = true;
+            }
+        }
+
+        bool broken = false;
+        vector<uint32_t> ready;
+        for (map<uint32_t, uint32_t>::iterator it = unknown.begin(); it != unknown.end(); it++){
+            if (it->second == 1){
+                ready.push_back(it->first);
+            }
+        }
+
+        while (ready.size()){
+            uint32_t v = ready.back();
+            ready.pop_back();
+            if (unknown[v] != 1){
+                continue;
+            }
+
+            // inflow == outflow at v
+            uint32_t solve = count;
+            uint64_t inflow = 0, outflow = 0;
+            vector<uint32_t>& edges = incident[v];
+            for (uint32_t j = 0; j < edges.size(); j++){
+                CounterEdge* e = &ctrs->Edges[first + edges[j]];
+                if (!known[edges[j]]){
+                    solve = edges[j];
+                    continue;
+                }
+                if (e->Target == v){
+                    inflow += values[edges[j]];
+                }
+                if (e->Source == v){
+                    outflow += values[edges[j]];
+                }
+            }
+            assert(solve < count);
+
+            CounterEdge* e = &ctrs->Edges[first + solve];
+            uint64_t need = (e->Target == v) ? outflow : inflow;
+            uint64_t have = (e->Target == v) ? inflow : outflow;
+            if (need < have){
+                if (!broken){
+                    warn << "Edge counts of group " << dec << ctrs->Edges[first].Group << " do not conserve flow, its block counts are not reliable" << ENDL;
+                }
+                broken = true;
+                need = have;
+            }
+            values[solve] = need - have;
+            known[solve] = true;
+
+            unknown[e->Source]--;
+            unknown[e->Target]--;
+            uint32_t other = (e->Source == v) ? e->Target : e->Source;
+            if (unknown[other] == 1){
+                ready.push_back(other);
+            }
+        }
+
+        for (uint32_t i = 0; i < count; i++){
+            CounterEdge* e = &ctrs->Edges[first + i];
+            if (e->Target != CounterEdge_virtual){
+                ctrs->Counters[e->Target] = 0;
+            }
+        }
+        for (uint32_t i = 0; i < count; i++){
+            CounterEdge* e = &ctrs->Edges[first + i];
+            if (e->Target != CounterEdge_virtual){
+                assert(known[i]);
+                ctrs->Counters[e->Target] += values[i];
+            }
+        }
+
+        first = last;
+    }
+}
+
+// trip counts of counted loops, from the induction register sums taken at their entries and exits
+void ReconstructInductionCounts(CounterArray* ctrs){
+    if (ctrs == NULL){
+        return;
+    }
+    for (uint32_t i = 0; i < ctrs->InductionCount; i++){
+        CounterInduction* ind = &ctrs->Inductions[i];
+        int64_t delta = (int64_t)(ctrs->Counters[ind->Exit] - ctrs->Counters[ind->Entry]);
+        ctrs->Counters[ind->Block] = delta / ind->Step;
+    }
+}
+
+// --sat: a removed block counter is its count at removal plus the growth of its parent since then, at the ratio the
+// two had over all threads at removal
+void ExtrapolateSaturatedCounts(image_key_t iid){
+    CounterArray* ctrs = (CounterArray*)AllData->GetData(iid, pthread_self());
+    for (uint32_t i = 0; i < ctrs->SaturationCount; i++){
+        CounterSaturation* sat = &ctrs->Saturations[i];
+        if (!sat->Removed || sat->ParentCount == 0){
+            continue;
+        }
+        double ratio = (double)sat->BlockCount / (double)sat->ParentCount;
+        for (set<thread_key_t>::iterator tit = AllData->allthreads.begin(); tit != AllData->allthreads.end(); tit++){
+            CounterArray* tc = (CounterArray*)AllData->GetData(iid, (*tit));
+            uint64_t growth = tc->Counters[sat->Parent] - tc->SaturationParents[i];
+            tc->Counters[sat->Block] += (uint64_t)(ratio * (double)growth + 0.5);
+        }
+    }
+}
+
 CounterArray* GenerateCounterArray(CounterArray* ctrs, uint32_t typ, image_key_t iid, thread_key_t tid, image_key_t firstimage){
     CounterArray* c = ctrs;
     c->threadid = tid;
@@ -112,6 +254,10 @@ CounterArray* GenerateCounterArray(CounterArray* ctrs, uint32_t typ, image_key_t
     memcpy(c, ctrs, sizeof(CounterArray));
 
     c->Counters = (uint64_t*)malloc(sizeof(uint64_t) * c->Size);
+    if (c->SaturationCount){
+        c->SaturationParents = (uint64_t*)malloc(sizeof(uint64_t) * c->SaturationCount);
+        memset(c->SaturationParents, 0, sizeof(uint64_t) * c->SaturationCount);
+    }
 
     c->Initialized = false;
     c->Master = false;
@@ -134,6 +280,9 @@ uint64_t RefCounterArray(CounterArray* ctrs){
 void DeleteCounterArray(CounterArray* ctrs){
     if (!ctrs->Initialized){
         free(ctrs->Counters);
+        if (ctrs->SaturationCount){
+            free(ctrs->SaturationParents);
+        }
         free(ctrs);
     }
 }
@@ -167,6 +316,38 @@ extern "C"
         return NULL;
     }
 
+    // --sat: the calling thread's count at a block reached the limit. remove the block's counter and check, and remember
+    // where every thread's counts stood so the rest can be extrapolated from the block's parent
+    int32_t counter_saturate(uint32_t slot, image_key_t* key){
+        static pthread_mutex_t saturation_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+        CounterArray* ctrs = (CounterArray*)AllData->GetData(*key, pthread_self());
+        assert(ctrs && slot < ctrs->SaturationCount);
+        CounterSaturation* sat = &ctrs->Saturations[slot];
+
+        pthread_mutex_lock(&saturation_mutex);
+        if (sat->Removed){
+            pthread_mutex_unlock(&saturation_mutex);
+            return 0;
+        }
+
+        set<uint64_t> keys;
+        keys.insert(SATURATION_KEY(*key, sat->Block, PointType_blockcount));
+        keys.insert(SATURATION_KEY(*key, sat->Block, PointType_saturate));
+        SetDynamicPoints(keys, false);
+
+        for (set<thread_key_t>::iterator tit = AllData->allthreads.begin(); tit != AllData->allthreads.end(); tit++){
+            CounterArray* tc = (CounterArray*)AllData->GetData(*key, (*tit));
+            tc->SaturationParents[slot] = tc->Counters[sat->Parent];
+            sat->BlockCount += tc->Counters[sat->Block];
+            sat->ParentCount += tc->Counters[sat->Parent];
+        }
+        sat->Removed = true;
+
+        pthread_mutex_unlock(&saturation_mutex);
+        return 0;
+    }
+
     void* tool_image_init(void* s, uint64_t* key, ThreadData* td){
         SAVE_STREAM_FLAGS(cout);
 
@@ -237,6 +418,15 @@ extern "C"
             const char* b = bfile.c_str();
             TryOpen(BlockFile, b);
 
+            // derive block counts from edge and induction counters for every image and thread
+            for (set<image_key_t>::iterator iit = AllData->allimages.begin(); iit != AllData->allimages.end(); iit++){
+                for (set<thread_key_t>::iterator tit = AllData->allthreads.begin(); tit != AllData->allthreads.end(); tit++){
+                    ReconstructEdgeCounts((CounterArray*)AllData->GetData((*iit), (*tit)));
+                    ReconstructInductionCounts((CounterArray*)AllData->GetData((*iit), (*tit)));
+                }
+                ExtrapolateSaturatedCounts((*iit));
+            }
+
             // tally up counter types
             uint32_t blockCount = 0;
             uint32_t loopCount = 0;                
@@ -332,6 +522,8 @@ extern "C"
                         idx = i;
                     } else if (c->Types[i] == CounterType_instruction){
                         idx = c->Counters[i];
+                    } else if (c->Types[i] == CounterType_edge || c->Types[i] == CounterType_induction){
+                        continue;
                     } else {
                         idx = i;
                     }
@@ -378,6 +570,55 @@ extern "C"
                     }
                 }
             }
+
+            // print the removed counters with the standard error of each extrapolation, taking a block's executions per
+            // parent execution as Poisson over the parent counts seen before removal
+            bool saturations = false;
+            for (set<image_key_t>::iterator iit = AllData->allimages.begin(); iit != AllData->allimages.end(); iit++){
+                CounterArray* c = (CounterArray*)AllData->GetData((*iit), pthread_self());
+                for (uint32_t i = 0; i < c->SaturationCount; i++){
+                    CounterSaturation* sat = &c->Saturations[i];
+                    if (!sat->Removed){
+                        continue;
+                    }
+                    if (!saturations){
+                        BlockFile
+                            << ENDL
+                            << "# saturation    = " << dec << c->SaturationLimit << ENDL
+                            << "# SAT" << TAB << "Sequence" << TAB << "Hashcode" << TAB << "ImageSequence" << TAB << "ParentSequence"
+                            << TAB << "CountAtRemoval" << TAB << "ParentAtRemoval" << TAB << "Extrapolated" << TAB << "StdError" << ENDL
+                            << ENDL;
+                        saturations = true;
+                    }
+
+                    uint64_t growth = 0;
+                    uint64_t counter = 0;
+                    for (set<thread_key_t>::iterator tit = AllData->allthreads.begin(); tit != AllData->allthreads.end(); tit++){
+                        CounterArray* tc = (CounterArray*)AllData->GetData((*iit), (*tit));
+                        growth += tc->Counters[sat->Parent] - tc->SaturationParents[i];
+                        counter += tc->Counters[sat->Block];
+                    }
+
+                    BlockFile
+                        << "SAT"
+                        << TAB << dec << sat->Block
+                        << TAB << hex << c->Hashes[sat->Block]
+                        << TAB << dec << AllData->GetImageSequence((*iit))
+                        << TAB << dec << sat->Parent
+                        << TAB << dec << sat->BlockCount
+                        << TAB << dec << sat->ParentCount
+                        << TAB << dec << counter;
+
+                    // no parent count to extrapolate from, the block was only counted up to its removal
+                    if (sat->ParentCount == 0){
+                        BlockFile << TAB << "-" << ENDL;
+                        continue;
+                    }
+                    double ratio = (double)sat->BlockCount / (double)sat->ParentCount;
+                    double error = (double)growth * sqrt(ratio / (double)sat->ParentCount);
+                    BlockFile << TAB << dec << (uint64_t)(error + 0.5) << ENDL;
+                }
+            }
         }
 
         inform << "cxxx Total Execution time for " << ctrs->Extension << "-instrumented image " << ctrs->Application << ": " << (AllData->GetTimer(*key, 1) - AllData->GetTimer(*key, 0)) << " seconds" << ENDL;
@@ -23,6 +23,44 @@
 
 #include <Metasim.hpp>
 
+// endpoints/counters of a flow edge in spanning tree (--edg) mode
+#define CounterEdge_virtual 0xffffffff
+#define CounterEdge_tree    0xffffffff
+
+// Source/Target index the counter of a block (or CounterEdge_virtual for function entry/exit)
+// Counter indexes the CounterType_edge counter of a chord, tree edges (CounterEdge_tree) are derived at exit
+typedef struct {
+    uint32_t Group;
+    uint32_t Source;
+    uint32_t Target;
+    uint32_t Counter;
+} CounterEdge;
+
+// a block of a counted loop runs once per iteration, its count is the sum of the induction register's values at loop
+// exit less those at loop entry (CounterType_induction counters Exit and Entry), over the register's step
+typedef struct {
+    uint32_t Block;
+    uint32_t Entry;
+    uint32_t Exit;
+    int32_t Step;
+} CounterInduction;
+
+// a block counter that removes itself after SaturationLimit executions (--sat). the rest of the run is extrapolated
+// from Parent, the live counter of its innermost loop's head or of its function's entry, at the ratio the two had when
+// it was removed. BlockCount and ParentCount are summed over threads at removal, and each thread keeps its own parent
+// count at that time in SaturationParents
+typedef struct {
+    uint32_t Block;
+    uint32_t Parent;
+    bool Removed;
+    uint64_t BlockCount;
+    uint64_t ParentCount;
+} CounterSaturation;
+
+// dynamic point keys of a saturating block's counter and check. block sequences are per image, so fold in the image key
+// (the key of the image's own init points) while keeping the point type in the low bits
+#define SATURATION_KEY(__img, __bid, __typ) (GENERATE_KEY(((uint64_t)(__bid) + 1), __typ) ^ ((__img) & ~(uint64_t)0xf))
+
 typedef struct {
     bool Initialized;
     bool PerInstruction;
@@ -39,6 +77,14 @@ typedef struct {
     char** Functions;
     char* Application;
     char* Extension;
+    uint32_t EdgeCount;
+    CounterEdge* Edges;
+    uint32_t InductionCount;
+    CounterInduction* Inductions;
+    uint64_t SaturationLimit;
+    uint32_t SaturationCount;
+    CounterSaturation* Saturations;
+    uint64_t* SaturationParents;
 } CounterArray;
 
 #endif //_CounterFunctions_hpp_
@@ -61,9 +61,7 @@ extern "C"
 
     // start timer
     int32_t loop_entry(uint32_t loopIndex, image_key_t* key) {
-        thread_key_t tid = pthread_self();
-
-        FrequencyConfig* fconfig = AllData->GetData(*key, pthread_self());
+        FrequencyConfig* fconfig = AllData->GetLocalData(key);
         assert(fconfig != NULL);
        
         // FIXME do throttling 
@@ -74,9 +72,7 @@ extern "C"
 
     // end timer
     int32_t loop_exit(uint32_t loopIndex, image_key_t* key) {
-        thread_key_t tid = pthread_self();
-
-        FrequencyConfig* fconfig = AllData->GetData(*key, pthread_self());
+        FrequencyConfig* fconfig = AllData->GetLocalData(key);
 
         // FIXME do nothing or reset frequency
 
@@ -0,0 +1,335 @@
+/*
+ * Hardware counter values accumulated in each loop/function
+ *
+ * file per rank
+ * loop/function: total
+ *   - per thread visits and counter values
+ * perf_event counter groups
+ */
+
+#include <InstrumentationCommon.hpp>
+#include <HardwareCounters.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include <iostream>
+
+
+DataManager<HardwareCounters*>* AllData = NULL;
+
+typedef struct {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+} CounterEvent;
+
+#define HW_CACHE_READ_MISS(__cache) \
+    ((__cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+// preferred events, the first is the group leader and must be available
+static CounterEvent HardwareEvents[] = {
+    { "cycles",       PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "llc_misses",   PERF_TYPE_HW_CACHE, HW_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL) },
+    { "l1d_misses",   PERF_TYPE_HW_CACHE, HW_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D) }
+};
+
+// used when there is no PMU access, eg. in most VMs
+static CounterEvent SoftwareEvents[] = {
+    { "task_clock",   PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { "page_faults",  PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS }
+};
+
+#define MAX_COUNTER_EVENTS (8)
+
+// chosen at the first tool_image_init, every thread opens the same group
+static CounterEvent ActiveEvents[MAX_COUNTER_EVENTS];
+static uint32_t EventCount = 0;
+
+// counter group of the calling thread, opened on its first region entry
+static __thread int32_t ThreadGroupFd = -1;
+static __thread bool ThreadGroupTried = false;
+
+static int32_t OpenCounter(CounterEvent* event, int32_t groupFd){
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event->type;
+    attr.config = event->config;
+    attr.disabled = (groupFd == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    return syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+// open the events as a single group led by the first one, filling fds and returning how many were opened.
+// events that fail to open are dropped when select is set and fail the whole group otherwise
+static uint32_t OpenCounterGroup(CounterEvent* events, uint32_t count, bool select, CounterEvent* opened, int32_t* fds){
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < count && n < MAX_COUNTER_EVENTS; i++){
+        int32_t fd = OpenCounter(&events[i], n == 0 ? -1 : fds[0]);
+        if (fd < 0){
+            if (n == 0 || !select){
+                for (uint32_t j = 0; j < n; j++){
+                    close(fds[j]);
+                }
+                return 0;
+            }
+            continue;
+        }
+        if (opened){
+            opened[n] = events[i];
+        }
+        fds[n++] = fd;
+    }
+    return n;
+}
+
+// decide on the event set by opening a trial group in the calling thread
+static void SelectCounterEvents(){
+    int32_t fds[MAX_COUNTER_EVENTS];
+    uint32_t count = OpenCounterGroup(HardwareEvents, sizeof(HardwareEvents) / sizeof(CounterEvent), true, ActiveEvents, fds);
+    if (count == 0){
+        warn << "hardware performance counters are not available, falling back to software events" << ENDL;
+        count = OpenCounterGroup(SoftwareEvents, sizeof(SoftwareEvents) / sizeof(CounterEvent), true, ActiveEvents, fds);
+    }
+    if (count == 0){
+        warn << "perf_event_open failed, only region visits will be reported" << ENDL;
+    }
+    for (uint32_t i = 0; i < count; i++){
+        close(fds[i]);
+    }
+    EventCount = count;
+}
+
+static void OpenThreadCounters(){
+    ThreadGroupTried = true;
+    if (EventCount == 0){
+        return;
+    }
+
+    int32_t fds[MAX_COUNTER_EVENTS];
+    if (OpenCounterGroup(ActiveEvents, EventCount, false, NULL, fds) == 0){
+        warn << "Thread " << hex << pthread_self() << " cannot open its counter group, its counters will read 0" << ENDL;
+        return;
+    }
+    ThreadGroupFd = fds[0];
+    ioctl(ThreadGroupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(ThreadGroupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+// a single grouped read gives { nr, values[nr] }
+static inline void ReadCounters(uint64_t* values){
+    if (!ThreadGroupTried){
+        OpenThreadCounters();
+    }
+
+    uint64_t buf[MAX_COUNTER_EVENTS + 1];
+    if (ThreadGroupFd < 0 || read(ThreadGroupFd, buf, sizeof(uint64_t) * (EventCount + 1)) <= 0){
+        memset(values, 0, sizeof(uint64_t) * EventCount);
+        return;
+    }
+    for (uint32_t i = 0; i < EventCount; i++){
+        values[i] = buf[i + 1];
+    }
+}
+
+/*
+ * When a new image is added, called once per existing thread
+ * When a new thread is added, called once per loaded image
+ *
+ * counters: some pre-existing data
+ * typ: ThreadTyp when called via AddThread
+ *      ImageTyp when called via AddImage
+ * iid: image the new data will be for
+ * tid: thread the new data will be for
+ * firstimage: key of first image created
+ *
+ */
+HardwareCounters* GenerateHardwareCounters(HardwareCounters* counters, uint32_t typ, image_key_t iid, thread_key_t tid, image_key_t firstimage) {
+    HardwareCounters* retval;
+    retval = new HardwareCounters();
+
+    retval->master = counters->master && typ == AllData->ImageType;
+    retval->application = counters->application;
+    retval->extension = counters->extension;
+    retval->regionCount = counters->regionCount;
+    retval->regionHashes = counters->regionHashes;
+    retval->regionNames = counters->regionNames;
+
+    uint64_t count = retval->regionCount;
+    retval->eventCount = EventCount;
+    retval->counterAccum = new uint64_t[(2 * EventCount + 1) * count];
+    retval->counterStart = retval->counterAccum + EventCount * count;
+    retval->regionVisits = retval->counterStart + EventCount * count;
+    retval->regionDepth = new uint32_t[count];
+
+    memset(retval->counterAccum, 0, sizeof(uint64_t) * (2 * EventCount + 1) * count);
+    memset(retval->regionDepth, 0, sizeof(uint32_t) * count);
+    return retval;
+}
+
+void DeleteHardwareCounters(HardwareCounters* counters){
+    delete[] counters->counterAccum;
+    delete[] counters->regionDepth;
+}
+
+uint64_t ReferenceHardwareCounters(HardwareCounters* counters){
+    return (uint64_t)counters->counterAccum;
+}
+
+extern "C"
+{
+
+    // snapshot the counters at the outermost entry to a region
+    int32_t hwcounter_entry(uint32_t regionIndex, image_key_t* key) {
+        HardwareCounters* counters = AllData->GetLocalData(key);
+        assert(counters != NULL);
+
+        counters->regionVisits[regionIndex]++;
+        if (counters->regionDepth[regionIndex]++ == 0){
+            ReadCounters(&counters->counterStart[regionIndex * counters->eventCount]);
+        }
+        return 0;
+    }
+
+    // accumulate the counter deltas at the outermost exit from a region
+    int32_t hwcounter_exit(uint32_t regionIndex, image_key_t* key) {
+        HardwareCounters* counters = AllData->GetLocalData(key);
+        assert(counters != NULL);
+
+        if (counters->regionDepth[regionIndex] == 0){
+            return 0;
+        }
+        if (--counters->regionDepth[regionIndex] == 0){
+            uint64_t now[MAX_COUNTER_EVENTS];
+            ReadCounters(now);
+
+            uint64_t* start = &counters->counterStart[regionIndex * counters->eventCount];
+            uint64_t* accum = &counters->counterAccum[regionIndex * counters->eventCount];
+            for (uint32_t i = 0; i < counters->eventCount; i++){
+                accum[i] += now[i] - start[i];
+            }
+        }
+        return 0;
+    }
+
+    // initialize dynamic instrumentation
+    void* tool_dynamic_init(uint64_t* count, DynamicInst** dyn) {
+        InitializeDynamicInstrumentation(count, dyn);
+        return NULL;
+    }
+
+    // Just after MPI_Init is called
+    void* tool_mpi_init() {
+        return NULL;
+    }
+
+    // Entry function for threads
+    void* tool_thread_init(thread_key_t tid) {
+        if (AllData){
+            AllData->AddThread(tid);
+        } else {
+            ErrorExit("Calling PEBIL thread initialization library for thread " << hex << tid << " but no images have been initialized.", MetasimError_NoThread);
+        }
+        return NULL;
+    }
+
+    // Optionally? called on thread join/exit?
+    void* tool_thread_fini(thread_key_t tid) {
+        return NULL;
+    }
+
+    // Called when new image is loaded
+    void* tool_image_init(void* args, image_key_t* key, ThreadData* td) {
+
+        HardwareCounters* counters = (HardwareCounters*)args;
+
+        // Remove this instrumentation
+        set<uint64_t> inits;
+        inits.insert(*key);
+        SetDynamicPoints(inits, false);
+
+        // If this is the first image, set up a data manager and pick the events to count
+        if (AllData == NULL){
+            AllData = new DataManager<HardwareCounters*>(GenerateHardwareCounters, DeleteHardwareCounters, ReferenceHardwareCounters);
+            SelectCounterEvents();
+        }
+
+        // Add this image
+        AllData->AddImage(counters, td, *key);
+        return NULL;
+    }
+
+    //
+    void* tool_image_fini(image_key_t* key) {
+
+        image_key_t iid = *key;
+
+        if (AllData == NULL){
+            ErrorExit("data manager does not exist. no images were intialized", MetasimError_NoImage);
+            return NULL;
+        }
+
+        HardwareCounters* counters = AllData->GetData(iid, pthread_self());
+        if (counters == NULL){
+            ErrorExit("Cannot retrieve image data using key " << dec << (*key), MetasimError_NoImage);
+            return NULL;
+        }
+
+        if (!counters->master){
+            printf("Image is not master, skipping\n");
+            return NULL;
+        }
+
+        char outFileName[1024];
+        sprintf(outFileName, "%s.meta_%0d.%s", counters->application, GetTaskId(), counters->extension);
+        FILE* outFile = fopen(outFileName, "w");
+        if (!outFile){
+            cerr << "error: cannot open output file %s" << outFileName << ENDL;
+            exit(-1);
+        }
+
+        fprintf(outFile, "# Events:");
+        for (uint32_t i = 0; i < EventCount; i++){
+            fprintf(outFile, " %s", ActiveEvents[i].name);
+        }
+        fprintf(outFile, "\n");
+
+        // for each image
+        //   for each region
+        //     for each thread
+        //       print visits and counters
+        for (set<image_key_t>::iterator iit = AllData->allimages.begin(); iit != AllData->allimages.end(); ++iit) {
+            HardwareCounters* imageData = AllData->GetData(*iit, pthread_self());
+
+            for (uint64_t regionIndex = 0; regionIndex < imageData->regionCount; ++regionIndex){
+                if (imageData->regionHashes){
+                    fprintf(outFile, "0x%llx:\n", imageData->regionHashes[regionIndex]);
+                } else {
+                    fprintf(outFile, "%s:\n", imageData->regionNames[regionIndex]);
+                }
+                for (set<thread_key_t>::iterator tit = AllData->allthreads.begin(); tit != AllData->allthreads.end(); ++tit) {
+                    HardwareCounters* c = AllData->GetData(*iit, *tit);
+                    fprintf(outFile, "\tThread: 0x%llx\tVisits: %llu", *tit, c->regionVisits[regionIndex]);
+                    for (uint32_t i = 0; i < c->eventCount; i++){
+                        fprintf(outFile, "\t%s: %llu", ActiveEvents[i].name, c->counterAccum[regionIndex * c->eventCount + i]);
+                    }
+                    fprintf(outFile, "\n");
+                }
+            }
+        }
+        fflush(outFile);
+        fclose(outFile);
+        return NULL;
+    }
+};
+
@@ -0,0 +1,22 @@
+
+#ifndef _HardwareCounters_hpp_
+#define _HardwareCounters_hpp_
+
+// regions are loops (identified by regionHashes) or functions (identified by regionNames)
+typedef struct {
+    bool master;
+    char* application;
+    char* extension;
+    uint64_t regionCount;
+    uint64_t* regionHashes;
+    char** regionNames;
+
+    // filled in per thread by the library, eventCount counters per region
+    uint32_t eventCount;
+    uint64_t* counterAccum;
+    uint64_t* counterStart;
+    uint64_t* regionVisits;
+    uint32_t* regionDepth;
+} HardwareCounters;
+
+#endif
@@ -186,6 +186,56 @@ static void ptimer(double *tmr) {
     *tmr=(double)timestr.tv_sec + 1.0E-06*(double)timestr.tv_usec;
 }
 
+// timestamp counter
+static inline uint64_t read_timestamp_counter(){
+    unsigned low, high;
+    __asm__ volatile ("rdtsc" : "=a" (low), "=d"(high));
+    return ((unsigned long long)low | (((unsigned long long)high) << 32));
+}
+
+// cpuid 0x80000007, edx bit 8: tsc ticks at a constant rate regardless of P/C-states
+static bool HasInvariantTimestampCounter(){
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (0x80000000));
+    if (eax < 0x80000007){
+        return false;
+    }
+    __asm__ volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (0x80000007));
+    return (edx & (1 << 8));
+}
+
+static inline uint64_t read_monotonic_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// tsc ticks per second measured against CLOCK_MONOTONIC, median of a few short intervals
+#define TSC_CALIBRATION_ROUNDS (5)
+#define TSC_CALIBRATION_NS (10000000)
+static double CalibrateTimestampCounter(){
+    double rates[TSC_CALIBRATION_ROUNDS];
+    for (uint32_t i = 0; i < TSC_CALIBRATION_ROUNDS; i++){
+        uint64_t ns0 = read_monotonic_ns();
+        uint64_t tsc0 = read_timestamp_counter();
+        uint64_t ns1;
+        do {
+            ns1 = read_monotonic_ns();
+        } while (ns1 - ns0 < TSC_CALIBRATION_NS);
+        uint64_t tsc1 = read_timestamp_counter();
+        rates[i] = (double)(tsc1 - tsc0) * 1.0E09 / (double)(ns1 - ns0);
+    }
+
+    for (uint32_t i = 1; i < TSC_CALIBRATION_ROUNDS; i++){
+        for (uint32_t j = i; j > 0 && rates[j] < rates[j-1]; j--){
+            double t = rates[j];
+            rates[j] = rates[j-1];
+            rates[j-1] = t;
+        }
+    }
+    return rates[TSC_CALIBRATION_ROUNDS / 2];
+}
+
 // support for output/warnings/errors
 #define METASIM_ID "Metasim"
 #define METASIM_VERSION "3.0.0"
@@ -414,10 +464,22 @@ static void AppendTasksString(string& str){
 // data management support
 #define DataMap std::pebil_map_type
 
+// per-thread cache of data pointers, indexed by image sequence. lets the
+// instrumentation hot paths avoid the nested DataMap lookups in GetData
+#define DataCacheImages (32)
+template <class T> struct DataCache {
+    void* owner;
+    uint32_t generation;
+    T data[DataCacheImages];
+};
+
 template <class T> class DataManager {
 private:
     pthread_mutex_t mutex;
 
+    static __thread DataCache<T> tlscache;
+    volatile uint32_t generation;
+
     DataMap <image_key_t, DataMap<thread_key_t, T> > datamap;
     T (*datagen)(T, uint32_t, image_key_t, thread_key_t, image_key_t);
     void (*datadel)(T);
@@ -476,6 +538,22 @@ private:
         assert(actual == h);
         return td[actual].data;
     }
+    // must be called by the thread that owns the data
+    void CacheData(image_key_t iid, T data){
+        DataCache<T>* c = &tlscache;
+        if (c->owner != (void*)this || c->generation != generation){
+            memset(c, 0, sizeof(DataCache<T>));
+            c->owner = (void*)this;
+            c->generation = generation;
+        }
+
+        uint32_t seq = GetImageSequence(iid);
+        if (seq >= DataCacheImages){
+            return;
+        }
+        c->data[seq] = data;
+    }
+
     void RemoveThreadData(image_key_t iid, thread_key_t tid){
         uint32_t h = HashThread(tid);
 
@@ -513,6 +591,7 @@ public:
 
         currentimageseq = 0;
         firstimage = 0;
+        generation = 1;
     }
 
     ~DataManager(){
@@ -592,6 +671,10 @@ public:
 
             assert(threaddata.count(*iit) == 1);
             SetThreadData((*iit), tid, ThreadType);
+
+            if (tid == pthread_self()){
+                CacheData((*iit), datamap[(*iit)][tid]);
+            }
         }
         allthreads.insert(tid);
         UnLock();
@@ -608,6 +691,9 @@ public:
         T data = datamap[iid][tid];
         datadel(data);
         datamap[iid].erase(tid);
+
+        // invalidates every thread's cache
+        generation++;
     }
 
     void RemoveThread(){
@@ -674,7 +760,13 @@ public:
         for (set<thread_key_t>::iterator it = allthreads.begin(); it != allthreads.end(); it++){
             datamap[iid][(*it)] = datagen(data, ImageType, iid, (*it), firstimage);
             assert(datamap[iid].count((*it)) == 1);
+
+            // threads that were running before the image was loaded find their own data through the thread hash
+            if ((*it) != tid){
+                SetThreadData(iid, (*it), ImageType);
+            }
         }
+        CacheData(iid, datamap[iid][tid]);
         UnLock();
         return iid;
     }
@@ -701,6 +793,30 @@ public:
         return t;
     }
 
+    // Return data for an image and the current thread. The common case
+    // is served from a thread-local cache, indexed by the slot kept next
+    // to the image's key, without touching datamap.
+    inline T GetLocalData(image_key_t* key){
+        DataCache<T>* c = &tlscache;
+        uint64_t slot = ImageSlotOf(key);
+        if (slot && c->owner == (void*)this && c->generation == generation){
+            T t = c->data[slot - 1];
+            if (t){
+                return t;
+            }
+        }
+
+        image_key_t iid = *key;
+        T t = GetData(iid, pthread_self());
+        CacheData(iid, t);
+
+        uint32_t seq = GetImageSequence(iid);
+        if (seq < DataCacheImages){
+            ImageSlotOf(key) = seq + 1;
+        }
+        return t;
+    }
+
     uint32_t CountThreads(){
         return allthreads.size();
     }
@@ -709,6 +825,8 @@ public:
     }
 };
 
+template <class T> __thread DataCache<T> DataManager<T>::tlscache;
+
 template <class T, class V> class FastData {
 private:
     uint32_t threadcount;
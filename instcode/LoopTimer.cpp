@@ -21,11 +21,71 @@
 
 DataManager<LoopTimers*>* AllData = NULL;
 
-#define CLOCK_RATE_HZ 2800000000
-inline uint64_t read_timestamp_counter(){
-    unsigned low, high;
-    __asm__ volatile ("rdtsc" : "=a" (low), "=d"(high));
-    return ((unsigned long long)low | (((unsigned long long)high) << 32));
+// measured at the first tool_image_init
+static double TimerFrequency = 0.0;
+static bool TimerInvariant = false;
+static uint64_t ProbeOverhead = 0;
+
+// set PEBIL_TIMER_COMPENSATE to subtract the probe overhead estimate from reported times
+#define TIMER_COMPENSATE_ENV "PEBIL_TIMER_COMPENSATE"
+#define PROBE_OVERHEAD_ROUNDS (5)
+#define PROBE_OVERHEAD_VISITS (1000)
+
+extern "C" {
+    int32_t loop_entry(uint32_t loopIndex, image_key_t* key);
+    int32_t loop_exit(uint32_t loopIndex, image_key_t* key);
+}
+
+// mirrors the inlined entry/exit snippets: [accum, last, visits]
+static void __attribute__ ((noinline)) InlinedProbeEntry(uint64_t* t){
+    t[2]++;
+    t[1] = read_timestamp_counter();
+}
+
+static void __attribute__ ((noinline)) InlinedProbeExit(uint64_t* t){
+    t[0] += read_timestamp_counter() - t[1];
+}
+
+/*
+ * Estimate of the ticks that an entry/exit pair adds to an empty region, taking the best
+ * of a few rounds. Library timers time loop_entry/loop_exit on the image's first loop, which
+ * is reset afterwards.
+ * Inlined timers are approximated by C that does the same loads, stores and rdtsc as the
+ * emitted snippets, so the estimate leaves out what pebil puts around those: the jumps to
+ * and from the trampoline, and the save/restore of flags and of scratch registers that are
+ * live at the probe site, which varies from site to site. Library timers likewise leave out
+ * the call wrapper. The estimate is therefore a lower bound on the real cost per visit.
+ */
+static uint64_t MeasureProbeOverhead(LoopTimers* timers, image_key_t* key, bool inlined){
+    uint64_t best = 0;
+    for (uint32_t r = 0; r < PROBE_OVERHEAD_ROUNDS; r++){
+        uint64_t t[3] = { 0, 0, 0 };
+        uint64_t* accum = t;
+        if (inlined){
+            for (uint32_t i = 0; i < PROBE_OVERHEAD_VISITS; i++){
+                InlinedProbeEntry(t);
+                InlinedProbeExit(t);
+            }
+        } else {
+            accum = &(timers->loopTimerAccum[0]);
+            *accum = 0;
+            for (uint32_t i = 0; i < PROBE_OVERHEAD_VISITS; i++){
+                loop_entry(0, key);
+                loop_exit(0, key);
+            }
+        }
+        uint64_t avg = *accum / PROBE_OVERHEAD_VISITS;
+        if (r == 0 || avg < best){
+            best = avg;
+        }
+    }
+
+    if (!inlined){
+        timers->loopTimerAccum[0] = 0;
+        timers->loopTimerLast[0] = 0;
+        timers->loopTimerVisits[0] = 0;
+    }
+    return best;
 }
 
 /*
@@ -42,6 +102,12 @@ inline uint64_t read_timestamp_counter(){
  */
 LoopTimers* GenerateLoopTimers(LoopTimers* timers, uint32_t typ, image_key_t iid, thread_key_t tid, image_key_t firstimage) {
 
+    // the image supplies timers for the thread that loads it when using inlined timers. threads that
+    // already exist get their own
+    if (typ == AllData->ImageType && tid == pthread_self() && timers->loopTimerAccum != NULL){
+        return timers;
+    }
+
     LoopTimers* retval;
     retval = new LoopTimers();
 
@@ -50,21 +116,22 @@ LoopTimers* GenerateLoopTimers(LoopTimers* timers, uint32_t typ, image_key_t iid
     retval->extension = timers->extension;
     retval->loopCount = timers->loopCount;
     retval->loopHashes = timers->loopHashes;
-    retval->loopTimerAccum = new uint64_t[retval->loopCount];
-    retval->loopTimerLast = new uint64_t[retval->loopCount];
 
-    memset(retval->loopTimerAccum, 0, sizeof(uint64_t) * retval->loopCount);
-    memset(retval->loopTimerLast, 0, sizeof(uint64_t) * retval->loopCount);
+    // keep Last and Visits right after Accum, inlined timers address all of them from the thread data
+    retval->loopTimerAccum = new uint64_t[3 * retval->loopCount];
+    retval->loopTimerLast = retval->loopTimerAccum + retval->loopCount;
+    retval->loopTimerVisits = retval->loopTimerLast + retval->loopCount;
+
+    memset(retval->loopTimerAccum, 0, sizeof(uint64_t) * 3 * retval->loopCount);
     return retval;
 }
 
 void DeleteLoopTimers(LoopTimers* timers){
-    delete timers->loopTimerAccum;
-    delete timers->loopTimerLast;
+    delete[] timers->loopTimerAccum;
 }
 
 uint64_t ReferenceLoopTimers(LoopTimers* timers){
-    return (uint64_t)timers;
+    return (uint64_t)timers->loopTimerAccum;
 }
 
 extern "C"
@@ -72,21 +139,18 @@ extern "C"
 
     // start timer
     int32_t loop_entry(uint32_t loopIndex, image_key_t* key) {
-        thread_key_t tid = pthread_self();
-
-        LoopTimers* timers = AllData->GetData(*key, pthread_self());
+        LoopTimers* timers = AllData->GetLocalData(key);
         assert(timers != NULL);
         assert(timers->loopTimerLast != NULL);
         
+        timers->loopTimerVisits[loopIndex]++;
         timers->loopTimerLast[loopIndex] = read_timestamp_counter();
         return 0;
     }
 
     // end timer
     int32_t loop_exit(uint32_t loopIndex, image_key_t* key) {
-        thread_key_t tid = pthread_self();
-
-        LoopTimers* timers = AllData->GetData(*key, pthread_self());
+        LoopTimers* timers = AllData->GetLocalData(key);
         uint64_t last = timers->loopTimerLast[loopIndex];
         uint64_t now = read_timestamp_counter();
         timers->loopTimerAccum[loopIndex] += now - last;
@@ -126,18 +190,33 @@ extern "C"
 
         LoopTimers* timers = (LoopTimers*)args;
 
+        // image supplies its own timers when they are inlined
+        bool inlined = (timers->loopTimerAccum != NULL);
+
         // Remove this instrumentation
         set<uint64_t> inits;
         inits.insert(*key);
         SetDynamicPoints(inits, false);
 
-        // If this is the first image, set up a data manager
+        // If this is the first image, set up a data manager and calibrate the timers
+        bool calibrate = false;
         if (AllData == NULL){
             AllData = new DataManager<LoopTimers*>(GenerateLoopTimers, DeleteLoopTimers, ReferenceLoopTimers);
+
+            TimerInvariant = HasInvariantTimestampCounter();
+            if (!TimerInvariant){
+                warn << "timestamp counter is not invariant, loop times may be skewed by frequency changes" << ENDL;
+            }
+            TimerFrequency = CalibrateTimestampCounter();
+            calibrate = true;
         }
 
         // Add this image
         AllData->AddImage(timers, td, *key);
+
+        if (calibrate && timers->loopCount > 0){
+            ProbeOverhead = MeasureProbeOverhead(AllData->GetLocalData(key), key, inlined);
+        }
         return NULL;
     }
 
@@ -170,6 +249,10 @@ extern "C"
             exit(-1);
         }
 
+        bool compensate = (getenv(TIMER_COMPENSATE_ENV) != NULL);
+        fprintf(outFile, "# TSC %.0f Hz (%s), estimated probe overhead %llu ticks per visit (lower bound), %s from times\n", TimerFrequency,
+                TimerInvariant ? "invariant" : "not invariant", ProbeOverhead, compensate ? "subtracted" : "not subtracted");
+
         // for each image
         //   for each loop
         //     for each thread
@@ -185,7 +268,13 @@ extern "C"
                 fprintf(outFile, "0x%llx:\n", loopHash);
                 for (set<thread_key_t>::iterator tit = AllData->allthreads.begin(); tit != AllData->allthreads.end(); ++tit) {
                     LoopTimers* timers = AllData->GetData(*iit, *tit);
-                    fprintf(outFile, "\tThread: 0x%llx\tTime: %f\n", *tit, (double)(timers->loopTimerAccum[loopIndex]) / CLOCK_RATE_HZ);
+                    uint64_t visits = timers->loopTimerVisits[loopIndex];
+                    uint64_t ticks = timers->loopTimerAccum[loopIndex];
+                    uint64_t overhead = visits * ProbeOverhead;
+                    if (compensate){
+                        ticks = (ticks > overhead) ? ticks - overhead : 0;
+                    }
+                    fprintf(outFile, "\tThread: 0x%llx\tTime: %f\tVisits: %llu\tOverhead: %f\n", *tit, (double)ticks / TimerFrequency, visits, (double)overhead / TimerFrequency);
                 }
             }
         }
@@ -10,6 +10,7 @@ typedef struct {
     uint64_t* loopHashes;
     uint64_t* loopTimerAccum;
     uint64_t* loopTimerLast;
+    uint64_t* loopTimerVisits;
 } LoopTimers;
 
 #endif
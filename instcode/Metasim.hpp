@@ -32,12 +32,19 @@
 typedef uint64_t image_key_t;
 typedef pthread_t thread_key_t;
 
+// pebil reserves a word after each image's key. the runtime keeps the image's slot in its
+// per-thread tables there, plus one so that 0 means not yet assigned
+#define ImageKeyWords (2)
+#define ImageSlotOf(__key) (((uint64_t*)(__key))[1])
+
 typedef enum {
     CounterType_undefined = 0,
     CounterType_instruction,
     CounterType_basicblock,
     CounterType_loop,
     CounterType_function,
+    CounterType_edge,
+    CounterType_induction,
     CounterType_total
 } CounterTypes;
 
@@ -45,8 +52,10 @@ static const char* CounterTypeNames[CounterType_total] = {
     "undefined",
     "instruction",
     "basicblock",
-    "loop"
-    "function"
+    "loop",
+    "function",
+    "edge",
+    "induction"
 };
 
 typedef struct {
@@ -107,6 +116,7 @@ typedef enum {
     PointType_buffercheck,
     PointType_bufferinc,
     PointType_bufferfill,
+    PointType_saturate,
     PointType_total
 } PointTypes;
 
@@ -21,12 +21,242 @@
 
 DataManager<FunctionTimers*>* AllData = NULL;
 
-//#define CLOCK_RATE_HZ 2800000000
-#define CLOCK_RATE_HZ 3326000000
-inline uint64_t read_timestamp_counter(){
-    unsigned low, high;
-    __asm__ volatile ("rdtsc" : "=a" (low), "=d"(high));
-    return ((unsigned long long)low | (((unsigned long long)high) << 32));
+// measured at the first tool_image_init
+static double TimerFrequency = 0.0;
+static bool TimerInvariant = false;
+static uint64_t ProbeOverhead = 0;
+
+// set PEBIL_TIMER_COMPENSATE to subtract the probe overhead estimate from reported times
+#define TIMER_COMPENSATE_ENV "PEBIL_TIMER_COMPENSATE"
+#define PROBE_OVERHEAD_ROUNDS (5)
+#define PROBE_OVERHEAD_VISITS (1000)
+
+extern "C" {
+    int32_t function_entry(uint32_t funcIndex, image_key_t* key);
+    int32_t function_exit(uint32_t funcIndex, image_key_t* key);
+}
+
+// mirrors the inlined entry/exit snippets: [accum, last, visits] and recursion depth
+static void __attribute__ ((noinline)) InlinedProbeEntry(uint64_t* t, uint32_t* depth){
+    t[2]++;
+    uint64_t now = read_timestamp_counter();
+    if (*depth != 0){
+        now = t[1];
+    }
+    (*depth)++;
+    t[1] = now;
+}
+
+static void __attribute__ ((noinline)) InlinedProbeExit(uint64_t* t, uint32_t* depth){
+    uint64_t now = read_timestamp_counter();
+    (*depth)--;
+    if (*depth != 0){
+        now = t[1];
+    }
+    t[0] += now - t[1];
+    t[1] = now;
+}
+
+/*
+ * Estimate of the ticks that an entry/exit pair adds to an empty function, taking the best
+ * of a few rounds. Library timers time function_entry/function_exit on the image's first
+ * function, which is reset afterwards.
+ * Inlined timers are approximated by C that does the same loads, stores and rdtsc as the
+ * emitted snippets, so the estimate leaves out what pebil puts around those: the jumps to
+ * and from the trampoline, and the save/restore of flags and of scratch registers that are
+ * live at the probe site, which varies from site to site. Library timers likewise leave out
+ * the call wrapper. The estimate is therefore a lower bound on the real cost per visit.
+ */
+static uint64_t MeasureProbeOverhead(FunctionTimers* timers, image_key_t* key, bool inlined){
+    uint64_t best = 0;
+    for (uint32_t r = 0; r < PROBE_OVERHEAD_ROUNDS; r++){
+        uint64_t t[3] = { 0, 0, 0 };
+        uint32_t depth = 0;
+        uint64_t* accum = t;
+        if (inlined){
+            for (uint32_t i = 0; i < PROBE_OVERHEAD_VISITS; i++){
+                InlinedProbeEntry(t, &depth);
+                InlinedProbeExit(t, &depth);
+            }
+        } else {
+            accum = &(timers->functionTimerAccum[0]);
+            *accum = 0;
+            for (uint32_t i = 0; i < PROBE_OVERHEAD_VISITS; i++){
+                function_entry(0, key);
+                function_exit(0, key);
+            }
+        }
+        uint64_t avg = *accum / PROBE_OVERHEAD_VISITS;
+        if (r == 0 || avg < best){
+            best = avg;
+        }
+    }
+
+    if (!inlined){
+        timers->functionTimerAccum[0] = 0;
+        timers->functionTimerLast[0] = 0;
+        timers->functionTimerVisits[0] = 0;
+        timers->inFunction[0] = 0;
+    }
+    return best;
+}
+
+/*
+ * Calling context tree
+ *
+ * Each thread keeps its own tree per image. Nodes come from a bump-pointer arena
+ * and find their children through a small open-addressing table keyed on function
+ * index, so entry/exit just moves the current node pointer.
+ */
+#define CALLPATH_ARENA_CHUNK (1 << 20)
+#define CALLPATH_INIT_CHILDREN (4)
+#define CALLPATH_ROOT_INDEX (0xffffffff)
+
+struct CallPathArena {
+    char* chunk;
+    uint64_t used;
+    CallPathArena* next;
+};
+
+struct CallPathNode {
+    uint32_t functionIndex;
+    uint32_t childCount;
+    uint32_t childCapacity;
+    CallPathNode** children;
+    CallPathNode* parent;
+    uint64_t visits;
+    uint64_t inclusive;
+    uint64_t childTime;
+    uint64_t start;
+};
+
+void* CallPathAllocate(FunctionTimers* timers, uint64_t size){
+    size = (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+    assert(size <= CALLPATH_ARENA_CHUNK);
+
+    CallPathArena* arena = timers->callArena;
+    if (arena == NULL || arena->used + size > CALLPATH_ARENA_CHUNK){
+        CallPathArena* fresh = new CallPathArena();
+        fresh->chunk = new char[CALLPATH_ARENA_CHUNK];
+        fresh->used = 0;
+        fresh->next = arena;
+        timers->callArena = fresh;
+        arena = fresh;
+    }
+
+    void* mem = arena->chunk + arena->used;
+    arena->used += size;
+    return mem;
+}
+
+void CallPathFree(FunctionTimers* timers){
+    CallPathArena* arena = timers->callArena;
+    while (arena){
+        CallPathArena* next = arena->next;
+        delete[] arena->chunk;
+        delete arena;
+        arena = next;
+    }
+    timers->callArena = NULL;
+    timers->callRoot = NULL;
+    timers->callCurrent = NULL;
+}
+
+CallPathNode* CallPathNewNode(FunctionTimers* timers, CallPathNode* parent, uint32_t funcIndex){
+    CallPathNode* node = (CallPathNode*)CallPathAllocate(timers, sizeof(CallPathNode));
+    memset(node, 0, sizeof(CallPathNode));
+    node->functionIndex = funcIndex;
+    node->parent = parent;
+    return node;
+}
+
+inline uint32_t CallPathSlot(uint32_t funcIndex, uint32_t capacity){
+    return (funcIndex * 0x9e3779b1) & (capacity - 1);
+}
+
+void CallPathInsertChild(CallPathNode** table, uint32_t capacity, CallPathNode* child){
+    uint32_t slot = CallPathSlot(child->functionIndex, capacity);
+    while (table[slot] != NULL){
+        slot = (slot + 1) & (capacity - 1);
+    }
+    table[slot] = child;
+}
+
+CallPathNode* CallPathFindChild(CallPathNode* node, uint32_t funcIndex){
+    if (node->childCapacity == 0){
+        return NULL;
+    }
+    uint32_t slot = CallPathSlot(funcIndex, node->childCapacity);
+    while (node->children[slot] != NULL){
+        if (node->children[slot]->functionIndex == funcIndex){
+            return node->children[slot];
+        }
+        slot = (slot + 1) & (node->childCapacity - 1);
+    }
+    return NULL;
+}
+
+CallPathNode* CallPathGetChild(FunctionTimers* timers, CallPathNode* node, uint32_t funcIndex){
+    CallPathNode* child = CallPathFindChild(node, funcIndex);
+    if (child){
+        return child;
+    }
+
+    // keep the table at most 3/4 full, old tables are left in the arena
+    if (4 * (node->childCount + 1) > 3 * node->childCapacity){
+        uint32_t capacity = node->childCapacity ? 2 * node->childCapacity : CALLPATH_INIT_CHILDREN;
+        CallPathNode** table = (CallPathNode**)CallPathAllocate(timers, capacity * sizeof(CallPathNode*));
+        memset(table, 0, capacity * sizeof(CallPathNode*));
+        for (uint32_t i = 0; i < node->childCapacity; i++){
+            if (node->children[i]){
+                CallPathInsertChild(table, capacity, node->children[i]);
+            }
+        }
+        node->children = table;
+        node->childCapacity = capacity;
+    }
+
+    child = CallPathNewNode(timers, node, funcIndex);
+    CallPathInsertChild(node->children, node->childCapacity, child);
+    node->childCount++;
+    return child;
+}
+
+// closes the activation of the current node and moves up to its parent
+inline void CallPathPop(FunctionTimers* timers, uint64_t now){
+    CallPathNode* node = timers->callCurrent;
+    uint64_t elapsed = now - node->start;
+    node->inclusive += elapsed;
+    node->parent->childTime += elapsed;
+    timers->callCurrent = node->parent;
+}
+
+// adds the totals of src (and its subtree) into dest
+void CallPathMerge(FunctionTimers* timers, CallPathNode* dest, CallPathNode* src){
+    dest->visits += src->visits;
+    dest->inclusive += src->inclusive;
+    dest->childTime += src->childTime;
+    for (uint32_t i = 0; i < src->childCapacity; i++){
+        CallPathNode* child = src->children[i];
+        if (child){
+            CallPathMerge(timers, CallPathGetChild(timers, dest, child->functionIndex), child);
+        }
+    }
+}
+
+void CallPathPrint(FILE* outFile, CallPathNode* node, char** functionNames, string path){
+    if (node->functionIndex != CALLPATH_ROOT_INDEX){
+        if (path.size()){
+            path += ";";
+        }
+        path += functionNames[node->functionIndex];
+        fprintf(outFile, "%llu\t%llu\t%llu\t%s\n", node->visits, node->inclusive, node->inclusive - node->childTime, path.c_str());
+    }
+    for (uint32_t i = 0; i < node->childCapacity; i++){
+        if (node->children[i]){
+            CallPathPrint(outFile, node->children[i], functionNames, path);
+        }
+    }
 }
 
 /*
@@ -43,6 +273,12 @@ inline uint64_t read_timestamp_counter(){
  */
 FunctionTimers* GenerateFunctionTimers(FunctionTimers* timers, uint32_t typ, image_key_t iid, thread_key_t tid, image_key_t firstimage) {
 
+    // the image supplies timers for the thread that loads it when using inlined timers. threads that
+    // already exist get their own
+    if (typ == AllData->ImageType && tid == pthread_self() && timers->functionTimerAccum != NULL){
+        return timers;
+    }
+
     FunctionTimers* retval;
     retval = new FunctionTimers();
 
@@ -51,25 +287,31 @@ FunctionTimers* GenerateFunctionTimers(FunctionTimers* timers, uint32_t typ, ima
     retval->extension = timers->extension;
     retval->functionCount = timers->functionCount;
     retval->functionNames = timers->functionNames;
-    retval->functionTimerAccum = new uint64_t[retval->functionCount];
-    retval->functionTimerLast = new uint64_t[retval->functionCount];
-    retval->inFunction = new uint32_t[retval->functionCount];
 
-    memset(retval->functionTimerAccum, 0, sizeof(*retval->functionTimerAccum) * retval->functionCount);
-    memset(retval->functionTimerLast, 0, sizeof(*retval->functionTimerLast) * retval->functionCount);
-    memset(retval->inFunction, 0, sizeof(*retval->inFunction) * retval->functionCount);
+    // keep Last, Visits and inFunction right after Accum, inlined timers address all of them from the thread data
+    uint64_t count = retval->functionCount;
+    uint64_t size = count * (3 * sizeof(uint64_t) + sizeof(uint32_t));
+    retval->functionTimerAccum = (uint64_t*)(new char[size]);
+    retval->functionTimerLast = retval->functionTimerAccum + count;
+    retval->functionTimerVisits = retval->functionTimerLast + count;
+    retval->inFunction = (uint32_t*)(retval->functionTimerVisits + count);
+
+    memset(retval->functionTimerAccum, 0, size);
+
+    retval->callRoot = NULL;
+    retval->callCurrent = NULL;
+    retval->callArena = NULL;
 
     return retval;
 }
 
 void DeleteFunctionTimers(FunctionTimers* timers){
-    delete timers->functionTimerAccum;
-    delete timers->functionTimerLast;
-    delete timers->inFunction;
+    CallPathFree(timers);
+    delete[] (char*)timers->functionTimerAccum;
 }
 
 uint64_t ReferenceFunctionTimers(FunctionTimers* timers){
-    return (uint64_t)timers;
+    return (uint64_t)timers->functionTimerAccum;
 }
 
 extern "C"
@@ -77,11 +319,10 @@ extern "C"
 
     // start timer
     int32_t function_entry(uint32_t funcIndex, image_key_t* key) {
-        thread_key_t tid = pthread_self();
-
-        FunctionTimers* timers = AllData->GetData(*key, pthread_self());
+        FunctionTimers* timers = AllData->GetLocalData(key);
         assert(timers != NULL);
         assert(timers->functionTimerLast != NULL);
+        timers->functionTimerVisits[funcIndex]++;
         if(timers->inFunction[funcIndex] == 0){
             timers->functionTimerLast[funcIndex] = read_timestamp_counter();
         }
@@ -91,8 +332,7 @@ extern "C"
 
     // end timer
     int32_t function_exit(uint32_t funcIndex, image_key_t* key) {
-        thread_key_t tid = pthread_self();
-        FunctionTimers* timers = AllData->GetData(*key, pthread_self());
+        FunctionTimers* timers = AllData->GetLocalData(key);
 
         uint32_t recDepth = timers->inFunction[funcIndex];
         --recDepth;
@@ -109,6 +349,49 @@ extern "C"
         return 0;
     }
 
+    // descend into the calling context for this function
+    int32_t callpath_entry(uint32_t funcIndex, image_key_t* key) {
+        FunctionTimers* timers = AllData->GetLocalData(key);
+        assert(timers != NULL);
+
+        if (timers->callRoot == NULL){
+            timers->callRoot = CallPathNewNode(timers, NULL, CALLPATH_ROOT_INDEX);
+            timers->callCurrent = timers->callRoot;
+        }
+
+        CallPathNode* node = CallPathGetChild(timers, timers->callCurrent, funcIndex);
+        node->visits++;
+        timers->callCurrent = node;
+        node->start = read_timestamp_counter();
+        return 0;
+    }
+
+    // return to the calling context of this function
+    int32_t callpath_exit(uint32_t funcIndex, image_key_t* key) {
+        uint64_t now = read_timestamp_counter();
+        FunctionTimers* timers = AllData->GetLocalData(key);
+        assert(timers != NULL);
+
+        if (timers->callRoot == NULL){
+            return 0;
+        }
+
+        // exits that skipped instrumentation (longjmp, tail calls...) unwind to the matching frame
+        CallPathNode* node = timers->callCurrent;
+        while (node != timers->callRoot && node->functionIndex != funcIndex){
+            node = node->parent;
+        }
+        if (node == timers->callRoot){
+            return 0;
+        }
+
+        while (timers->callCurrent != node){
+            CallPathPop(timers, now);
+        }
+        CallPathPop(timers, now);
+        return 0;
+    }
+
     // initialize dynamic instrumentation
     void* tool_dynamic_init(uint64_t* count, DynamicInst** dyn) {
         InitializeDynamicInstrumentation(count, dyn);
@@ -140,18 +423,33 @@ extern "C"
 
         FunctionTimers* timers = (FunctionTimers*)args;
 
+        // image supplies its own timers when they are inlined
+        bool inlined = (timers->functionTimerAccum != NULL);
+
         // Remove this instrumentation
         set<uint64_t> inits;
         inits.insert(*key);
         SetDynamicPoints(inits, false);
 
-        // If this is the first image, set up a data manager
+        // If this is the first image, set up a data manager and calibrate the timers
+        bool calibrate = false;
         if (AllData == NULL){
             AllData = new DataManager<FunctionTimers*>(GenerateFunctionTimers, DeleteFunctionTimers, ReferenceFunctionTimers);
+
+            TimerInvariant = HasInvariantTimestampCounter();
+            if (!TimerInvariant){
+                warn << "timestamp counter is not invariant, function times may be skewed by frequency changes" << ENDL;
+            }
+            TimerFrequency = CalibrateTimestampCounter();
+            calibrate = true;
         }
 
         // Add this image
         AllData->AddImage(timers, td, *key);
+
+        if (calibrate && timers->functionCount > 0){
+            ProbeOverhead = MeasureProbeOverhead(AllData->GetLocalData(key), key, inlined);
+        }
         return NULL;
     }
 
@@ -185,6 +483,10 @@ extern "C"
         }
 
 
+        bool compensate = (getenv(TIMER_COMPENSATE_ENV) != NULL);
+        fprintf(outFile, "# TSC %.0f Hz (%s), estimated probe overhead %llu ticks per visit (lower bound), %s from times\n", TimerFrequency,
+                TimerInvariant ? "invariant" : "not invariant", ProbeOverhead, compensate ? "subtracted" : "not subtracted");
+
         // for each image
         //   for each function
         //     for each thread
@@ -200,9 +502,44 @@ extern "C"
                 fprintf(outFile, "\n%s:\t", fname);
                 for (set<thread_key_t>::iterator tit = AllData->allthreads.begin(); tit != AllData->allthreads.end(); ++tit) {
                     FunctionTimers* timers = AllData->GetData(*iit, *tit);
-                    fprintf(outFile, "\tThread: 0x%llx\tTime: %f\t", *tit, (double)(timers->functionTimerAccum[funcIndex]) / CLOCK_RATE_HZ);
+                    uint64_t visits = timers->functionTimerVisits[funcIndex];
+                    uint64_t ticks = timers->functionTimerAccum[funcIndex];
+                    uint64_t overhead = visits * ProbeOverhead;
+                    if (compensate){
+                        ticks = (ticks > overhead) ? ticks - overhead : 0;
+                    }
+                    fprintf(outFile, "\tThread: 0x%llx\tTime: %f\tVisits: %llu\tOverhead: %f\t", *tit, (double)ticks / TimerFrequency, visits, (double)overhead / TimerFrequency);
+                }
+            }
+        }
+
+        // for each image
+        //   close activations that are still open (eg. main) and merge the calling context trees of all threads
+        //   print visits/inclusive/exclusive cycles per call path
+        uint64_t now = read_timestamp_counter();
+        for (set<image_key_t>::iterator iit = AllData->allimages.begin(); iit != AllData->allimages.end(); ++iit) {
+            FunctionTimers merged;
+            memset(&merged, 0, sizeof(FunctionTimers));
+            merged.callRoot = CallPathNewNode(&merged, NULL, CALLPATH_ROOT_INDEX);
+
+            bool hasCallPaths = false;
+            for (set<thread_key_t>::iterator tit = AllData->allthreads.begin(); tit != AllData->allthreads.end(); ++tit) {
+                FunctionTimers* timers = AllData->GetData(*iit, *tit);
+                if (timers->callRoot){
+                    while (timers->callCurrent != timers->callRoot){
+                        CallPathPop(timers, now);
+                    }
+                    CallPathMerge(&merged, merged.callRoot, timers->callRoot);
+                    hasCallPaths = true;
                 }
             }
+
+            if (hasCallPaths){
+                FunctionTimers* imageData = AllData->GetData(*iit, pthread_self());
+                fprintf(outFile, "\n\n# Visits\tInclusive\tExclusive\tCallPath\n");
+                CallPathPrint(outFile, merged.callRoot, imageData->functionNames, string());
+            }
+            CallPathFree(&merged);
         }
         fflush(outFile);
         fclose(outFile);
@@ -2,6 +2,9 @@
 #ifndef _TimerFunctions_hpp_
 #define _TimerFunctions_hpp_
 
+struct CallPathNode;
+struct CallPathArena;
+
 typedef struct {
     bool master;
     char* application;
@@ -10,7 +13,13 @@ typedef struct {
     char** functionNames;
     uint64_t* functionTimerAccum;
     uint64_t* functionTimerLast;
+    uint64_t* functionTimerVisits;
     uint32_t* inFunction;
+
+    // calling context tree, only used by callpath_entry/callpath_exit
+    CallPathNode* callRoot;
+    CallPathNode* callCurrent;
+    CallPathArena* callArena;
 } FunctionTimers;
 
 #endif
@@ -0,0 +1,64 @@
+#!/usr/bin/env bash
+
+# compares the hit rate of each cache level that two CacheSimulation runs wrote to the summary lines
+# of their .siminst files. the reference can be any file holding such lines. prints the levels whose
+# hit rates differ by more than the tolerance (default 0.02) and exits non-zero if there are any
+
+function echo_err() {
+    msg=$1
+    echo "$msg" >&2
+}
+
+function print_usage(){
+    if [ "$1" != "" ]; then
+        echo_err "!!!!! error: $1"
+    fi
+    echo_err "     usage: $0 <reference_siminst_file> <siminst_file> [tolerance]"
+    echo_err ""
+    exit 1
+}
+
+reference=$1
+rates=$2
+tolerance=$3
+
+if [ "$reference" == "" ] || [ "$rates" == "" ]; then
+    print_usage "two simulation files are needed"
+fi
+for f in $reference $rates; do
+    if [ ! -f "$f" ]; then
+        print_usage "cannot find simulation file: $f"
+    fi
+done
+if [ "$tolerance" == "" ]; then
+    tolerance=0.02
+fi
+
+# summary lines look like: #<tab>0 l0[2950819/3080009(0.958055)] l1[51169/129190(0.396076)]
+awk -v tol=$tolerance '
+FNR == 1 { file++ }
+$1 == "#" && $3 ~ /^l0\[/ {
+    for (i = 3; i <= NF; i++){
+        level = $2 " " substr($i, 1, index($i, "[") - 1)
+        rate = substr($i, index($i, "(") + 1)
+        rate = substr(rate, 1, index(rate, ")") - 1)
+        if (file == 1){
+            ref[level] = rate
+        } else {
+            got[level] = rate
+        }
+        seen[level] = 1
+    }
+}
+END {
+    bad = 0
+    n = 0
+    for (l in seen){
+        n++
+        if (!(l in ref) || !(l in got) || ref[l] - got[l] > tol || got[l] - ref[l] > tol){
+            printf("sysid/level %s: hit rate %s in %s, %s in %s\n", l, ref[l], ARGV[1], got[l], ARGV[2])
+            bad++
+        }
+    }
+    exit (bad != 0 || n == 0)
+}' $reference $rates
@@ -0,0 +1,59 @@
+#!/usr/bin/env bash
+
+# compares the block counts that two BasicBlockCounter runs of the same executable wrote to their
+# .jbbinst files, matching blocks by hashcode. a block that is not listed has a count of 0. prints
+# the blocks that differ and exits non-zero if there are any. a block whose counter the second run
+# removed at saturation (a SAT line) only has to be within 3 standard errors of the reference, or at
+# most the reference if its count was not extrapolated
+
+function echo_err() {
+    msg=$1
+    echo "$msg" >&2
+}
+
+function print_usage(){
+    if [ "$1" != "" ]; then
+        echo_err "!!!!! error: $1"
+    fi
+    echo_err "     usage: $0 <reference_jbbinst_file> <jbbinst_file>"
+    echo_err ""
+    exit 1
+}
+
+reference=$1
+counts=$2
+
+if [ "$reference" == "" ] || [ "$counts" == "" ]; then
+    print_usage "two count files are needed"
+fi
+for f in $reference $counts; do
+    if [ ! -f "$f" ]; then
+        print_usage "cannot find count file: $f"
+    fi
+done
+
+awk '
+FNR == 1 { file++ }
+$1 == "BLK" && file == 1 { ref[$3] = $5; seen[$3] = 1 }
+$1 == "BLK" && file == 2 { cnt[$3] = $5; seen[$3] = 1 }
+$1 == "SAT" && file == 2 { err[$3] = $9 }
+END {
+    bad = 0
+    for (h in seen){
+        diff = ref[h] - cnt[h]
+        if (h in err){
+            if (err[h] == "-"){
+                ok = (diff >= 0)
+            } else {
+                ok = (diff <= 3 * err[h] && -diff <= 3 * err[h])
+            }
+        } else {
+            ok = (diff == 0)
+        }
+        if (!ok){
+            printf("block %s: %s in %s, %s in %s\n", h, ref[h] + 0, ARGV[1], cnt[h] + 0, ARGV[2])
+            bad++
+        }
+    }
+    exit (bad != 0)
+}' $reference $counts
@@ -0,0 +1,139 @@
+/*
+ * This file is part of the pebil project.
+ *
+ * Copyright (c) 2010, University of California Regents
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* counted loops for BasicBlockCounter to count by their induction register. this is built with
+   optimization so that each loop keeps its counter in a register and leaves through a test of it.
+   which register the compiler picks is up to it, so the asm loops pin theirs to ones that can be used */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define ARRAY_SIZE 1000
+#define REPEAT_COUNT 100
+
+int64_t data_array[ARRAY_SIZE];
+
+int64_t __attribute__((noinline)) sum_up(int64_t* a, int32_t n){
+    int64_t s = 0;
+    int32_t i;
+    for (i = 0; i < n; i++){
+        s += a[i];
+    }
+    return s;
+}
+
+int64_t __attribute__((noinline)) mix_down(int64_t* a, int64_t n){
+    int64_t s = 0;
+    int64_t i;
+    for (i = n - 1; i >= 0; i -= 2){
+        s ^= a[i];
+    }
+    return s;
+}
+
+int64_t __attribute__((noinline)) sum_strided(int64_t* a, int32_t n){
+    int64_t s = 0;
+    int32_t i;
+    for (i = 3; i < n; i += 7){
+        s += a[i] * i;
+    }
+    return s;
+}
+
+/* 64-bit counter in rcx stepping up by 1. n must be positive */
+int64_t __attribute__((noinline)) count_up(int64_t n){
+    int64_t i = 0;
+    int64_t s = 0;
+    __asm__ volatile(
+        "1:\n\t"
+        "add %%rcx, %%rdx\n\t"
+        "add $1, %%rcx\n\t"
+        "cmp %2, %%rcx\n\t"
+        "jl 1b\n\t"
+        : "+c"(i), "+d"(s)
+        : "r"(n)
+        : "cc");
+    return s;
+}
+
+/* 32-bit counter in esi stepping down by 3. n must be positive */
+int64_t __attribute__((noinline)) count_down(int32_t n){
+    int32_t i = n;
+    int64_t s = 0;
+    __asm__ volatile(
+        "1:\n\t"
+        "add $5, %%rdx\n\t"
+        "sub $3, %%esi\n\t"
+        "jg 1b\n\t"
+        : "+S"(i), "+d"(s)
+        :
+        : "cc");
+    return s;
+}
+
+/* 64-bit counter in r8 stepping up by 7, in a loop body of two blocks. n must be positive */
+int64_t __attribute__((noinline)) count_chain(int64_t n){
+    register int64_t i __asm__("r8") = 0;
+    int64_t s = 0;
+    __asm__ volatile(
+        "1:\n\t"
+        "add %%r8, %%rdx\n\t"
+        "jmp 2f\n\t"
+        "2:\n\t"
+        "add $7, %%r8\n\t"
+        "cmp %2, %%r8\n\t"
+        "jl 1b\n\t"
+        : "+r"(i), "+d"(s)
+        : "r"(n)
+        : "cc");
+    return s;
+}
+
+int main(int argc, char* argv[]){
+    int32_t i, n = ARRAY_SIZE;
+    int64_t total = 0;
+
+    if (argc > 1){
+        n = atoi(argv[1]);
+    }
+    if (n < 0 || n > ARRAY_SIZE){
+        fprintf(stderr, "Error: count must be between 0 and %d\n", ARRAY_SIZE);
+        exit(-1);
+    }
+
+    for (i = 0; i < n; i++){
+        data_array[i] = i * 3 + 1;
+    }
+    for (i = 0; i < REPEAT_COUNT; i++){
+        total += sum_up(data_array, n - i);
+        total += mix_down(data_array, n - 2 * i);
+        total += sum_strided(data_array, n - 3 * i);
+        if (n - i > 0){
+            total += count_up(n - i);
+            total += count_down(n - i);
+            total += count_chain(n - i);
+        }
+    }
+
+    printf("total is %lld\n", (long long)total);
+    printf("(Test Application Successfull)\n");
+    return 0;
+}
@@ -22,6 +22,25 @@
 #define _BasicBlockCounter_h_
 
 #include <InstrumentationTool.h>
+#include <CounterFunctions.hpp>
+#include <map>
+
+// a flow edge for spanning tree counting (--edg). a NULL block is the function's virtual entry/exit
+typedef struct {
+    BasicBlock* source;
+    BasicBlock* target;
+    uint64_t weight;
+    bool uncountable;
+    bool chord;
+} FlowEdge;
+
+// a loop whose blocks run once per iteration while a single register steps by a constant
+typedef struct {
+    Loop* loop;
+    uint32_t reg;
+    bool signExtend;
+    int32_t step;
+} InductionLoop;
 
 class BasicBlockCounter : public InstrumentationTool {
 protected:
@@ -31,17 +50,32 @@ protected:
     InstrumentationFunction* loopEntry;
     InstrumentationFunction* loopExit;
 
+    InstrumentationFunction* saturateFunc;
+    uint32_t saturateSlotRegister;
+
     bool loopCount;
+
+    std::map<uint64_t, uint64_t>* blockProfile;
+    std::map<std::pair<BasicBlock*, BasicBlock*>, BasicBlock*> interposedEdges;
+
+    void readBlockProfile();
+    uint64_t blockWeight(BasicBlock* bb);
+    bool planEdgeCounters(Function* f, Vector<FlowEdge*>* edges);
+    BasicBlock* interposeEdge(BasicBlock* source, BasicBlock* target);
+    X86Instruction* findEdgePoint(BasicBlock* source, BasicBlock* target, InstLocations* loc);
+    bool findInductionLoop(Loop* loop, InductionLoop* ind);
+    void insertSaturationCheck(InstrumentationPoint* counter, uint32_t slot, uint32_t blockSeq, uint64_t counterOffset, uint32_t threadReg, bool beforeReturn);
+    void initializeHiddenCounter(CounterArray* ctrs, uint32_t idx, CounterTypes typ, BasicBlock* bb, uint64_t noData);
 public:
     BasicBlockCounter(ElfFile* elf);
-    ~BasicBlockCounter() {}
+    ~BasicBlockCounter() { if (blockProfile){ delete blockProfile; } }
 
     void declare();
     void instrument();
 
     const char* briefName() { return "BasicBlockCounter"; }
     const char* defaultExtension() { return "jbbinst"; }
-    uint32_t allowsArgs() { return PEBIL_OPT_LPI | PEBIL_OPT_DTL; }
+    uint32_t allowsArgs() { return PEBIL_OPT_LPI | PEBIL_OPT_DTL | PEBIL_OPT_EDG | PEBIL_OPT_NOI | PEBIL_OPT_INP | PEBIL_OPT_SAT; }
     uint32_t requiresArgs() { return PEBIL_OPT_NON; }
 };
 
@@ -31,6 +31,13 @@ protected:
     InstrumentationFunction* functionEntry;
     InstrumentationFunction* functionExit;
 
+    uint64_t functionTimerBlock;
+    uint32_t functionTimerCount;
+    uint32_t functionEntryIndexRegister;
+    uint32_t functionExitIndexRegister;
+
+    InstrumentationPoint* instrumentFunctionTimer(X86Instruction* point, InstLocations loc, uint32_t idx, bool entry);
+
 public:
     FunctionTimer(ElfFile* elf);
     ~FunctionTimer() {}
@@ -39,8 +46,8 @@ public:
     void instrument();
 
     const char* briefName() { return "FunctionTimer"; }
-    const char* defaultExtension() { return "ftminst"; }
-    uint32_t allowsArgs() { return PEBIL_OPT_NON; }
+    const char* defaultExtension() { if (hwCounters) { return "fhcinst"; } else if (callingContext) { return "cctinst"; } else { return "ftminst"; } }
+    uint32_t allowsArgs() { return PEBIL_OPT_CCT | PEBIL_OPT_HWC; }
     uint32_t requiresArgs() { return PEBIL_OPT_NON; }
 };
 
@@ -32,7 +32,14 @@ private:
 
     Vector<char*>* loopList;
 
+    bool inlineTimers;
+    uint64_t loopTimerBlock;
+    uint32_t loopTimerCount;
+    uint32_t loopEntryIndexRegister;
+    uint32_t loopExitIndexRegister;
+
     uint64_t getLoopHash(uint32_t idx);
+    InstrumentationPoint* instrumentLoopTimer(Base* point, InstLocations loc, uint32_t site, bool entry);
 
     bool discoveryMode;
     void discoverAllLoops();
@@ -45,9 +52,9 @@ public:
     void instrument();
 
     const char* briefName() { return "LoopIntercept"; }
-    const char* defaultExtension() { return "lpiinst"; }
+    const char* defaultExtension() { if (hwCounters) { return "lhcinst"; } else { return "lpiinst"; } }
     const char* getExtension() { if (discoveryMode) return "loops"; return defaultExtension(); }
-    uint32_t allowsArgs() { return PEBIL_OPT_INP; }
+    uint32_t allowsArgs() { return PEBIL_OPT_INP | PEBIL_OPT_HWC; }
 };
 
 #endif /* _LoopIntercept_h_ */